@@ -0,0 +1,75 @@
+#include "Atom.h"
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace JSO2 {
+
+	namespace {
+
+		struct stored {
+			std::string text;
+			Atom::entry entry;
+		};
+
+		// key の string_view は stored の text を指す. 終了時にも破棄しない
+		struct shared_pool {
+			std::mutex																										lock;
+			std::unordered_map<std::string_view, std::unique_ptr<stored>> entries;
+		};
+		shared_pool &shared() {
+			static auto &pool = *new shared_pool;
+			return pool;
+		}
+
+	}
+
+	Atom intern(std::string_view key) {
+		auto														&pool = shared();
+		std::lock_guard<std::mutex> guard(pool.lock);
+		auto it = pool.entries.find(key);
+		if(it == pool.entries.end()) {
+			auto e				= std::make_unique<stored>();
+			e->text				= key;
+			e->entry.text = e->text;
+			e->entry.hash = key_hash(key);
+			e->entry.by		= Atom::owner::program;
+			it						= pool.entries.emplace(e->text, std::move(e)).first;
+		}
+		return Atom(&it->second->entry);
+	}
+
+	// 実体と文字列を続けて 1 度に確保する
+	const Atom::entry *Key::make(std::string_view text) {
+		void *p = ::operator new(sizeof(Atom::entry) + text.size());
+		char *s = (char *)p + sizeof(Atom::entry);
+		std::memcpy(s, text.data(), text.size());
+		return new(p) Atom::entry{{s, text.size()}, key_hash(text), Atom::owner::counted, 1};
+	}
+	void Key::release(const Atom::entry *e) {
+		e->~entry();
+		::operator delete((void *)e);
+	}
+
+	Atom KeyPool::intern(std::string_view key) {
+		if(auto it = _entries.find(key); it != _entries.end()) return Atom(it->second.id());
+		const Atom::entry *e = nullptr;
+		{
+			auto														&pool = shared();
+			std::lock_guard<std::mutex> guard(pool.lock);
+			if(auto it = pool.entries.find(key); it != pool.entries.end()) e = &it->second->entry;
+		}
+		if(!e && !_arena) e = Key::make(key);
+		if(!e) {
+			char *text = (char *)_arena->allocate(key.size(), 1);
+			std::memcpy(text, key.data(), key.size());
+			e = new(_arena->allocate(sizeof(Atom::entry), alignof(Atom::entry)))
+					Atom::entry{{text, key.size()}, key_hash(key), Atom::owner::pool};
+		}
+		_entries.emplace(e->text, Key(e));
+		return Atom(e);
+	}
+
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace JSO2 {
+
+	// Object の key の hash. FlatMap と Atom で共通
+	inline uint32_t key_hash(std::string_view key) {
+		return uint32_t(std::hash<std::string_view>()(key));
+	}
+
+	// intern した key. 同じ文字列の Atom は同じ実体を指すので,
+	// 比較は pointer だけで済み, hash も作った時に一度だけ求める.
+	// intern の実体は program の終了まで, arena の KeyPool の実体は KeyPool の clear まで,
+	// heap の KeyPool の実体はそれを指す Key が無くなるまで解放しない.
+	class Atom {
+	public:
+		enum class owner : uint8_t {
+			program,	// intern. 解放しない
+			pool,			// arena の KeyPool
+			counted		// heap. Key が参照の数を数える
+		};
+		struct entry {
+			std::string_view							text;
+			uint32_t											hash;
+			owner													by;
+			mutable std::atomic<uint32_t> refs = 0;	// counted の参照の数
+		};
+
+	private:
+		const entry *_entry;
+
+		explicit Atom(const entry *e) : _entry(e) {}
+		friend Atom intern(std::string_view key);
+		friend class KeyPool;
+		friend class Key;
+
+	public:
+		std::string			 str() const { return std::string(_entry->text); }
+		std::string_view view() const { return _entry->text; }
+		uint32_t				 hash() const { return _entry->hash; }
+		const entry			*id() const { return _entry; }
+
+		bool operator==(const Atom &other) const { return _entry == other._entry; }
+		bool operator!=(const Atom &other) const { return _entry != other._entry; }
+	};
+
+	// key を全体で共有する表に登録し, その Atom を返す. 複数の thread から呼んでよい.
+	// 登録した key は解放されないので, 入力から得た任意の key を渡してはならない.
+	Atom intern(std::string_view key);
+
+	// FlatMap の key. Atom の実体を指すので, 同じ実体の key は文字列を共有し pointer で比べられる.
+	// counted の実体は指す Key の数を数え, 最後の Key が解放する.
+	// 複製は arena の KeyPool の実体を heap に写す. 複製先は pool より長く生きうる
+	class Key {
+		const Atom::entry *_entry;
+
+		explicit Key(const Atom::entry *e) : _entry(e) {}
+		static const Atom::entry *make(std::string_view text);
+		static void								release(const Atom::entry *e);
+		static const Atom::entry *share(const Atom::entry *e) {
+			if(e->by == Atom::owner::counted) e->refs.fetch_add(1, std::memory_order_relaxed);
+			return e;
+		}
+		// arena の KeyPool の実体は heap に写す
+		static const Atom::entry *own(const Atom::entry *e) {
+			return e->by == Atom::owner::pool ? make(e->text) : share(e);
+		}
+		friend class KeyPool;
+
+	public:
+		// 新しい counted の実体を作る
+		explicit Key(std::string_view text) : _entry(make(text)) {}
+		explicit Key(const Atom &atom) : _entry(own(atom._entry)) {}
+		// arena の KeyPool の実体も写さずに指す. pool の clear より先に破棄すること
+		static Key borrow(const Atom &atom) { return Key(share(atom._entry)); }
+		Key(const Key &other) : _entry(own(other._entry)) {}
+		Key(Key &&other) noexcept : _entry(other._entry) { other._entry = nullptr; }
+		Key &operator=(Key other) noexcept {
+			std::swap(_entry, other._entry);
+			return *this;
+		}
+		~Key() {
+			if(_entry && _entry->by == Atom::owner::counted &&
+				 _entry->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				release(_entry);
+		}
+
+		std::string_view view() const { return _entry->text; }
+		operator std::string_view() const { return _entry->text; }
+		const char			*data() const { return _entry->text.data(); }
+		size_t					 size() const { return _entry->text.size(); }
+		size_t					 length() const { return _entry->text.size(); }
+		uint32_t				 hash() const { return _entry->hash; }
+		const Atom::entry *id() const { return _entry; }
+
+		bool operator==(const Key &other) const {
+			return _entry == other._entry || view() == other.view();
+		}
+		bool				operator<(const Key &other) const { return view() < other.view(); }
+		friend bool operator==(const Key &key, std::string_view text) { return key.view() == text; }
+	};
+
+	// key を共有する表. intern で登録済みの key はその Atom を返すので,
+	// load した木を intern した Atom で引くと pointer の比較で見つかる.
+	// arena を与えれば表と新しい key の実体を arena に置き, 無ければ counted の実体を heap に作る.
+	// 複数の thread から同時に呼んではならない.
+	class KeyPool {
+		std::pmr::memory_resource								 *_arena;
+		std::pmr::unordered_map<std::string_view, Key> _entries;
+
+	public:
+		explicit KeyPool(std::pmr::memory_resource *arena = nullptr)
+				: _arena(arena), _entries(arena ? arena : std::pmr::get_default_resource()) {}
+
+		Atom intern(std::string_view key);
+		// arena を解放する前に呼ぶ
+		void clear() { _entries = decltype(_entries)(_entries.get_allocator()); }
+	};
+
+}
@@ -0,0 +1,153 @@
+#include "Base64.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace JSO2::base64 {
+
+	namespace {
+
+		const char alphabet[] =
+				"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+		// 文字の 6 bit の値. base64 でなければ ('=' も) -1
+		constexpr auto table = [] {
+			std::array<int8_t, 256> t{};
+			t.fill(-1);
+			for(int i = 0; i < 64; ++i) t[uint8_t(alphabet[i])] = int8_t(i);
+			return t;
+		}();
+
+#ifdef __SSE2__
+		// lo <= c <= hi の byte. 符号付きの比較なので 0x80 以上の byte は入らない
+		__m128i in(__m128i v, char lo, char hi) {
+			return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(char(lo - 1))),
+													 _mm_cmplt_epi8(v, _mm_set1_epi8(char(hi + 1))));
+		}
+#endif
+
+	}
+
+#ifdef __SSE2__
+	const char *find_end(const char *p, const char *end) {
+		for(; end - p >= 16; p += 16) {
+			const __m128i v			= _mm_loadu_si128((const __m128i *)p);
+			const __m128i valid = _mm_or_si128(
+					_mm_or_si128(in(v, 'A', 'Z'), in(v, 'a', 'z')),
+					_mm_or_si128(in(v, '0', '9'),
+											 _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('+')),
+																		_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')),
+																								 _mm_cmpeq_epi8(v, _mm_set1_epi8('='))))));
+			const int mask = _mm_movemask_epi8(valid);
+			if(mask != 0xffff) return p + __builtin_ctz(~mask);
+		}
+		while(p < end && (table[uint8_t(*p)] >= 0 || *p == '=')) ++p;
+		return p;
+	}
+#else
+	const char *find_end(const char *p, const char *end) {
+		while(p < end && (table[uint8_t(*p)] >= 0 || *p == '=')) ++p;
+		return p;
+	}
+#endif
+
+	size_t decoded_length(const char *first, const char *last) {
+		const size_t len = last - first;
+		if(len % 4) return size_t(-1);
+		size_t n = len / 4 * 3;
+		if(len && last[-1] == '=') --n;
+		if(len && last[-2] == '=') --n;
+		return n;
+	}
+
+	unsigned char *decode(const char *first, const char *last, unsigned char *dest) {
+		const char *p = first;
+		if((last - p) % 4) return nullptr;
+#ifdef __SSE2__
+		// 16 文字を 6 bit ずつの値に直して 12 byte に詰める. 3 byte ずつを 4 byte で書くので,
+		// 後ろに 1 組 (4 文字) 以上残る間だけ行う. '=' や不正な文字は以下の 1 組ずつの処理に任せる.
+		while(last - p >= 20) {
+			const __m128i v			= _mm_loadu_si128((const __m128i *)p);
+			const __m128i upper = in(v, 'A', 'Z');
+			const __m128i lower = in(v, 'a', 'z');
+			const __m128i digit = in(v, '0', '9');
+			const __m128i plus	= _mm_cmpeq_epi8(v, _mm_set1_epi8('+'));
+			const __m128i slash = _mm_cmpeq_epi8(v, _mm_set1_epi8('/'));
+			const __m128i valid =
+					_mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(plus, slash)));
+			if(_mm_movemask_epi8(valid) != 0xffff) break;
+
+			const __m128i offset = _mm_or_si128(
+					_mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')),
+											 _mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))),
+					_mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(52 - '0')),
+											 _mm_or_si128(_mm_and_si128(plus, _mm_set1_epi8(62 - '+')),
+																		_mm_and_si128(slash, _mm_set1_epi8(63 - '/')))));
+			const __m128i sextet = _mm_add_epi8(v, offset);
+			// 16 bit の下位 byte が先の文字
+			const __m128i pair = _mm_or_si128(
+					_mm_and_si128(_mm_slli_epi16(sextet, 6), _mm_set1_epi16(0x0fc0)),
+					_mm_srli_epi16(sextet, 8));
+			// 32 bit ごとに 24 bit の値. 上位の byte が先
+			const __m128i quad = _mm_or_si128(
+					_mm_slli_epi32(_mm_and_si128(pair, _mm_set1_epi32(0xffff)), 12),
+					_mm_srli_epi32(pair, 16));
+			alignas(16) uint32_t bits[4];
+			_mm_store_si128((__m128i *)bits, quad);
+			for(int k = 0; k < 4; ++k) {
+				const uint32_t bytes = __builtin_bswap32(bits[k] << 8);
+				std::memcpy(dest + 3 * k, &bytes, 4);
+			}
+			dest += 12;
+			p += 16;
+		}
+#endif
+		for(; p != last; p += 4) {
+			const int a = table[uint8_t(p[0])];
+			const int b = table[uint8_t(p[1])];
+			const int c = table[uint8_t(p[2])];
+			const int d = table[uint8_t(p[3])];
+			if(last - p == 4 && p[3] == '=') {
+				if((a | b) < 0) return nullptr;
+				*dest++ = a << 2 | b >> 4;
+				if(p[2] == '=') return dest;
+				if(c < 0) return nullptr;
+				*dest++ = b << 4 | c >> 2;
+				return dest;
+			}
+			if((a | b | c | d) < 0) return nullptr;
+			dest[0] = a << 2 | b >> 4;
+			dest[1] = b << 4 | c >> 2;
+			dest[2] = c << 6 | d;
+			dest += 3;
+		}
+		return dest;
+	}
+
+	char *encode(char *dest, const void *src, size_t n) {
+		const unsigned char *s = (const unsigned char *)src;
+		for(; n >= 3; n -= 3, s += 3) {
+			const uint32_t v = uint32_t(s[0]) << 16 | uint32_t(s[1]) << 8 | s[2];
+			dest[0]					 = alphabet[v >> 18];
+			dest[1]					 = alphabet[v >> 12 & 63];
+			dest[2]					 = alphabet[v >> 6 & 63];
+			dest[3]					 = alphabet[v & 63];
+			dest += 4;
+		}
+		if(n) {
+			const uint32_t v = uint32_t(s[0]) << 16 | (n == 2 ? uint32_t(s[1]) << 8 : 0);
+			dest[0]					 = alphabet[v >> 18];
+			dest[1]					 = alphabet[v >> 12 & 63];
+			dest[2]					 = n == 2 ? alphabet[v >> 6 & 63] : '=';
+			dest[3]					 = '=';
+			dest += 4;
+		}
+		return dest;
+	}
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+
+namespace JSO2::base64 {
+
+	// RFC 4648 の base64 (A-Z, a-z, 0-9, '+', '/'). 末尾は '=' で 4 文字の倍数に詰める.
+	// 途中の改行や空白は許さない.
+
+	// n byte を符号化した長さ
+	constexpr size_t encoded_length(size_t n) { return (n + 2) / 3 * 4; }
+
+	// p から base64 の文字 ('=' を含む) が続く範囲の終わり
+	const char *find_end(const char *p, const char *end);
+
+	// [first, last) を復号した長さ. 長さが 4 の倍数でなければ size_t(-1)
+	size_t decoded_length(const char *first, const char *last);
+
+	// [first, last) を dest に復号し, 書き終えた位置を返す.
+	// base64 でない文字や途中の '=' を含めば nullptr.
+	// dest には decoded_length 以上の領域が必要.
+	unsigned char *decode(const char *first, const char *last, unsigned char *dest);
+
+	// src の n byte を dest に符号化し, 書き終えた位置を返す.
+	// dest には encoded_length(n) 以上の領域が必要.
+	char *encode(char *dest, const void *src, size_t n);
+
+}
@@ -0,0 +1,251 @@
+#include "Binary.h"
+
+#include "Builder.h"
+#include "MappedFile.h"
+
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace JSO2::binary {
+
+	namespace {
+
+		const char *const message = "Invalid sequence for Binary\n";
+
+		void put_varint(std::string &dest, uint64_t n) {
+			char	 buf[10];
+			size_t len = 0;
+			for(; n >= 0x80; n >>= 7) buf[len++] = char(n | 0x80);
+			buf[len++] = char(n);
+			dest.append(buf, len);
+		}
+
+		void put_string(std::string &dest, std::string_view str) {
+			put_varint(dest, str.size());
+			dest.append(str);
+		}
+
+		void put_number(std::string &dest, double x) {
+			uint64_t bits = std::bit_cast<uint64_t>(x);
+			char		 buf[8];
+			for(int i = 0; i < 8; ++i, bits >>= 8) buf[i] = char(bits);
+			dest.append(buf, 8);
+		}
+
+		// [p, end) から読む. 足りなければ std::invalid_argument
+		struct input {
+			const char *p;
+			const char *end;
+
+			uint8_t byte() {
+				if(p == end) throw std::invalid_argument(message);
+				return uint8_t(*p++);
+			}
+
+			uint64_t varint() {
+				uint64_t n = 0;
+				for(int shift = 0; shift < 64; shift += 7) {
+					const uint8_t b = byte();
+					n |= uint64_t(b & 0x7f) << shift;
+					if(!(b & 0x80)) return n;
+				}
+				throw std::invalid_argument(message);
+			}
+
+			std::string_view string() {
+				const uint64_t len = varint();
+				if(len > uint64_t(end - p)) throw std::invalid_argument(message);
+				std::string_view str(p, len);
+				p += len;
+				return str;
+			}
+
+			double number() {
+				if(end - p < 8) throw std::invalid_argument(message);
+				uint64_t bits = 0;
+				for(int i = 7; i >= 0; --i) bits = bits << 8 | uint8_t(p[i]);
+				p += 8;
+				return std::bit_cast<double>(bits);
+			}
+
+			// numbers の中身. 要素数と byte 数を確かめてから dest に読む
+			size_t numbers_count() {
+				const uint64_t n = varint();
+				if(n > uint64_t(end - p) / 8) throw std::invalid_argument(message);
+				return n;
+			}
+			void numbers(double *dest, size_t n) {
+				for(size_t i = 0; i < n; ++i) dest[i] = number();
+			}
+
+			// 要素数. 各要素は 1 byte 以上なので残りの byte 数を超えない
+			size_t count() {
+				const uint64_t n = varint();
+				if(n > uint64_t(end - p)) throw std::invalid_argument(message);
+				return n;
+			}
+		};
+
+	}
+
+	void encode_to(std::string &dest, const JSO2 &src) {
+		struct frame {
+			const JSO2									*node;
+			JSO2::Object::const_iterator key;		 // Object の次の要素
+			size_t											 index;	 // Array の次の要素
+		};
+		std::vector<frame> stack;
+
+		dest.append(magic);
+		dest.push_back(char(version));
+		auto put = [&](const JSO2 &node) {
+			switch(node.get_type()) {
+				case type::Null:
+					dest.push_back(char(tag::null));
+					break;
+				case type::False:
+					dest.push_back(char(tag::False));
+					break;
+				case type::True:
+					dest.push_back(char(tag::True));
+					break;
+				case type::Number:
+					dest.push_back(char(tag::number));
+					put_number(dest, (const JSO2::Number &)node);
+					break;
+				case type::String:
+					dest.push_back(char(tag::string));
+					put_string(dest, node.view());
+					break;
+				case type::Array: {
+					if(node.packed()) {
+						const auto xs = node.numbers();
+						dest.push_back(char(tag::numbers));
+						put_varint(dest, xs.size());
+						for(double x : xs) put_number(dest, x);
+						break;
+					}
+					dest.push_back(char(tag::array));
+					put_varint(dest, ((const JSO2::Array &)node).size());
+					stack.push_back({&node, {}, 0});
+				} break;
+				case type::Object: {
+					const auto &obj = (const JSO2::Object &)node;
+					dest.push_back(char(tag::object));
+					put_varint(dest, obj.size());
+					stack.push_back({&node, obj.begin(), 0});
+				} break;
+				default:
+					throw std::logic_error("Error: undefined type!");
+			}
+		};
+
+		put(src);
+		while(!stack.empty()) {
+			frame &f = stack.back();
+			if(f.node->get_type() == type::Array) {
+				const auto &arr = (const JSO2::Array &)*f.node;
+				if(f.index == arr.size())
+					stack.pop_back();
+				else
+					put(arr[f.index++]);
+			} else {
+				const auto &obj = (const JSO2::Object &)*f.node;
+				if(f.key == obj.end())
+					stack.pop_back();
+				else {
+					const auto &[key, val] = *f.key++;
+					put_string(dest, key);
+					put(val);
+				}
+			}
+		}
+	}
+
+	std::string encode(const JSO2 &src) {
+		std::string dest;
+		encode_to(dest, src);
+		return dest;
+	}
+
+	bool decode(JSO2 &dest, std::string_view src, size_t max_depth) {
+		if(src.empty()) return false;
+		if(src.size() <= magic.size() || src.substr(0, magic.size()) != magic)
+			throw std::invalid_argument(message);
+		const uint8_t v = uint8_t(src[magic.size()]);
+		if(v != version && v != 1) throw std::invalid_argument(message);
+
+		// 開いている container と残りの要素数. 木は JSO2::load と同じ builder で組む
+		struct frame {
+			bool	 object;
+			size_t rest;
+		};
+		std::vector<frame> stack;
+		input							 in{src.data() + magic.size() + 1, src.data() + src.size()};
+		JSO2::builder			 b;
+
+		do {
+			if(!stack.empty()) {
+				frame &f = stack.back();
+				if(f.rest == 0) {
+					if(f.object)
+						b.on_object_end();
+					else
+						b.on_array_end();
+					stack.pop_back();
+					continue;
+				}
+				--f.rest;
+				if(f.object) b.on_key(in.string());
+			}
+			const tag t = tag(in.byte());
+			switch(t) {
+				case tag::null:
+					b.on_null();
+					break;
+				case tag::False:
+					b.on_bool(false);
+					break;
+				case tag::True:
+					b.on_bool(true);
+					break;
+				case tag::number:
+					b.on_number(in.number());
+					break;
+				case tag::string:
+					b.on_string(in.string());
+					break;
+				case tag::numbers: {
+					if(v == 1) throw std::invalid_argument(message);
+					const size_t n = in.numbers_count();
+					in.numbers(b.on_numbers(n), n);
+				} break;
+				case tag::array:
+				case tag::object: {
+					if(stack.size() >= max_depth)
+						throw std::length_error("JSO2 : nesting exceeds max_depth\n");
+					const size_t n = in.count();
+					if(t == tag::array)
+						b.on_array_begin();
+					else
+						b.on_object_begin();
+					stack.push_back({t == tag::object, n});
+				} break;
+				default:
+					throw std::invalid_argument(message);
+			}
+		} while(!stack.empty());
+
+		if(in.p != in.end) throw std::invalid_argument(message);
+		dest = std::move(b.root);
+		return true;
+	}
+
+	bool decode_file(JSO2 &dest, const std::string &path, size_t max_depth) {
+		MappedFile file(path);
+		return decode(dest, file.view(), max_depth);
+	}
+
+}
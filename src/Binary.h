@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "JSO2.h"
+
+// JSO2 の木を text を介さずに書き出し / 読み戻す binary 形式.
+// 先頭に magic "JSO2" と版 1 byte を置き, 続けて値を 1 つ書く.
+//   値     : tag 1 byte + 中身
+//   null / false / true : 中身なし
+//   number : IEEE 754 の bit をそのまま 8 byte, little endian
+//   string : 長さ (varint) + byte 列
+//   array  : 要素数 (varint) + 値を順に
+//   object : 要素数 (varint) + (key の長さ (varint) + key + 値) を順に
+//   numbers : 詰めた Array. 要素数 (varint) + number の中身を隙間なく並べたもの
+// varint は下位から 7 bit ずつ, 続きがあれば最上位 bit を立てる (LEB128).
+// 版 1 は numbers を持たない. decode は版 1 も読む.
+namespace JSO2::binary {
+
+	enum class tag : uint8_t { null, False, True, number, string, array, object, numbers };
+
+	constexpr std::string_view magic	 = "JSO2";
+	constexpr uint8_t					 version = 2;
+
+	// dest の末尾に追記する. 型の無い値 (type::Value) は std::logic_error
+	void				encode_to(std::string &dest, const JSO2 &src);
+	std::string encode(const JSO2 &src);
+
+	// 空の入力なら false. 形式に合わない, 途中で切れている, 値の後ろに余りがある
+	// 場合は std::invalid_argument, 入れ子が max_depth を超えれば std::length_error.
+	// JSO2::load と同じく数だけの Array は詰める.
+	bool decode(JSO2 &dest, std::string_view src,
+							size_t max_depth = JSO2::default_max_depth);
+	bool decode_file(JSO2 &dest, const std::string &path,
+									 size_t max_depth = JSO2::default_max_depth);
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+#include "Atom.h"
+#include "JSO2.h"
+#include "Sax.h"
+
+namespace JSO2 {
+
+	// 値を詰めている途中の Object / Array を stack に積み, 次の値の置き場所を決める.
+	// JSO2::load と Document の他, Reader, parallel::load, binary::decode,
+	// MappedDocument も event をこれに渡し, 数だけの Array を同じく Numbers に詰める.
+	// arena が与えられた場合は container と文字列を arena 上に確保する.
+	// [first, last) が与えられた場合は, その中を指す長い文字列を複製しない.
+	// key は keys で intern し, 同じ key の Object で実体を共有する.
+	// keys が無ければ builder の持つ heap の表を使う. 実体は Key が参照の数で持つ.
+	struct JSO2::builder : sax::handler {
+		std::pmr::memory_resource *arena;
+		KeyPool										 pool;
+		KeyPool										 *keys;
+		const char								 *first;
+		const char								 *last;
+		JSO2											 root;
+		std::vector<JSO2 *>				 stack;
+		JSO2											*member		 = nullptr;	// on_key で作った Object の要素
+		bool											 undecided = false;		// stack の先頭の Array がまだ要素を持たない
+
+		explicit builder(std::pmr::memory_resource *arena = nullptr, const char *first = nullptr,
+										 const char *last = nullptr, KeyPool *keys = nullptr)
+				: arena(arena), keys(keys ? keys : &pool), first(first), last(last) {}
+
+		// 開いている Object / Array が無い. 値を 1 つ渡し終えれば root に揃っている
+		bool done() const { return stack.empty(); }
+
+		void on_object_begin();
+		void on_object_end() { stack.pop_back(); }
+		void on_array_begin();
+		void on_array_end();
+		void on_key(std::string_view key);
+		void on_string(std::string_view str);
+		void on_number(double x);
+		// block は詰めた Array の領域へ直接復号する
+		void on_numbers(const sax::block &b);
+		// n 個の数の詰めた Array を置き, 値を書き込む先を返す
+		double *on_numbers(size_t n);
+		void		on_bool(bool b) { slot() = b; }
+		void		on_null() { slot() = nullptr; }
+
+	private:
+		JSO2 &slot();
+		template <class T>
+		void make(JSO2 &s, type t, size_t layout = 0);
+	};
+
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Atom.h"
+
+namespace JSO2 {
+
+	// 文字列を key とする連想配列. 要素を挿入順に連続した領域へ並べ,
+	// key の hash を添えた open addressing の表で引く.
+	// 要素が linear_limit 個以下の間は表を作らず先頭から順に比べる.
+	// key は Atom の実体を指す Key なので, 同じ KeyPool で load した Object は key の文字列を共有する.
+	// 引くときは実体の pointer を先に比べ, 違えば hash と文字列で比べる.
+	// intern の Atom を非 const で引いた要素は key をその実体に替え, 以後 pointer の比較で見つける.
+	// 反復は挿入順. iterator から key を書き換えてはならない.
+	template <class T>
+	class FlatMap {
+	public:
+		using key_type			 = Key;
+		using mapped_type		 = T;
+		using value_type		 = std::pair<Key, T>;
+		using size_type			 = size_t;
+		using allocator_type = std::pmr::polymorphic_allocator<value_type>;
+		using iterator			 = typename std::pmr::vector<value_type>::iterator;
+		using const_iterator = typename std::pmr::vector<value_type>::const_iterator;
+
+	private:
+		struct slot {
+			uint32_t hash;
+			uint32_t entry;	 // 0 : 空き, それ以外は _entries の位置 + 1
+		};
+
+		std::pmr::vector<value_type> _entries;
+		std::pmr::vector<slot>			 _slots;	// 空か 2 の冪の大きさ
+
+		bool match(size_t i, std::string_view key, uint32_t h, const Atom::entry *id) const {
+			const Key &k = _entries[i].first;
+			return k.id() == id || (k.hash() == h && k.view() == key);
+		}
+
+		// key の入った slot, 無ければ入れるべき空き slot
+		slot &probe(std::string_view key, uint32_t h, const Atom::entry *id) const {
+			const size_t mask = _slots.size() - 1;
+			for(size_t i = h & mask;; i = (i + 1) & mask) {
+				slot &s = const_cast<slot &>(_slots[i]);
+				if(s.entry == 0 || (s.hash == h && match(s.entry - 1, key, h, id))) return s;
+			}
+		}
+
+		// key の位置. 無ければ size()
+		size_t locate(std::string_view key, uint32_t h, const Atom::entry *id) const {
+			if(_slots.empty()) {
+				size_t i = 0;
+				while(i < _entries.size() && !match(i, key, h, id)) ++i;
+				return i;
+			}
+			const slot &s = probe(key, h, id);
+			return s.entry ? s.entry - 1 : _entries.size();
+		}
+
+		void rehash(size_t capacity) {
+			_slots.assign(capacity, slot{0, 0});
+			for(size_t i = 0; i < _entries.size(); ++i) {
+				const Key &key = _entries[i].first;
+				probe(key, key.hash(), nullptr) = {key.hash(), uint32_t(i + 1)};
+			}
+		}
+
+		// n 個の要素に必要な表の大きさ. 負荷率を 3/4 以下に保つ
+		static size_t capacity_for(size_t n) {
+			size_t capacity = 16;
+			while(capacity * 3 < n * 4) capacity *= 2;
+			return capacity;
+		}
+
+		// 要素の数に合わせて表を作り直す, または捨てる
+		void reindex() {
+			if(_entries.size() <= linear_limit)
+				_slots.clear();
+			else
+				rehash(capacity_for(_entries.size()));
+		}
+
+		// key の位置. 無ければ make() の返す Key で要素を足す
+		template <class Make>
+		size_t insert(std::string_view key, uint32_t h, const Atom::entry *id, Make &&make) {
+			if(_slots.empty()) {
+				const size_t i = locate(key, h, id);
+				if(i < _entries.size()) return i;
+				_entries.emplace_back(make(), T());
+				if(_entries.size() > linear_limit) reindex();
+				return _entries.size() - 1;
+			}
+			if((_entries.size() + 1) * 4 > _slots.size() * 3) rehash(_slots.size() * 2);
+			slot &s = probe(key, h, id);
+			if(s.entry == 0) {
+				_entries.emplace_back(make(), T());
+				s = {h, uint32_t(_entries.size())};
+			}
+			return s.entry - 1;
+		}
+
+	public:
+		static constexpr size_t linear_limit = 8;
+
+		FlatMap() {}
+		FlatMap(std::pmr::memory_resource *resource) : _entries(resource), _slots(resource) {}
+
+		iterator			 begin() { return _entries.begin(); }
+		iterator			 end() { return _entries.end(); }
+		const_iterator begin() const { return _entries.begin(); }
+		const_iterator end() const { return _entries.end(); }
+		size_t				 size() const { return _entries.size(); }
+		bool					 empty() const { return _entries.empty(); }
+
+		iterator find(std::string_view key) {
+			return begin() + locate(key, key_hash(key), nullptr);
+		}
+		const_iterator find(std::string_view key) const {
+			return begin() + locate(key, key_hash(key), nullptr);
+		}
+		// 文字列で一致した要素の key を替えない (const から同時に引けるように)
+		const_iterator find(const Atom &key) const {
+			return begin() + locate(key.view(), key.hash(), key.id());
+		}
+		bool	 contains(std::string_view key) const { return find(key) != end(); }
+		size_t count(std::string_view key) const { return contains(key); }
+
+		T &operator[](std::string_view key) {
+			const size_t i = insert(key, key_hash(key), nullptr, [&] { return Key(key); });
+			return _entries[i].second;
+		}
+		T &operator[](const std::string &key) { return (*this)[std::string_view(key)]; }
+		T &operator[](const char *key) { return (*this)[std::string_view(key)]; }
+		T &operator[](const Atom &key) {
+			const size_t i = insert(key.view(), key.hash(), key.id(), [&] { return Key(key); });
+			Key				  &k = _entries[i].first;
+			if(k.id() != key.id() && key.id()->by == Atom::owner::program) k = Key(key);
+			return _entries[i].second;
+		}
+		// Key をそのまま置く. Key::borrow した Key もそのまま指す
+		T &operator[](Key key) {
+			const size_t i =
+					insert(key.view(), key.hash(), key.id(), [&] { return std::move(key); });
+			return _entries[i].second;
+		}
+
+		T &at(std::string_view key) {
+			auto it = find(key);
+			if(it == end()) throw std::out_of_range("FlatMap::at");
+			return it->second;
+		}
+		const T &at(std::string_view key) const {
+			return const_cast<FlatMap *>(this)->at(key);
+		}
+
+		void reserve(size_t n) {
+			_entries.reserve(n);
+			if(n > linear_limit && capacity_for(n) > _slots.size())
+				rehash(capacity_for(n));
+		}
+
+		void clear() {
+			_entries.clear();
+			_slots.clear();
+		}
+
+		// 後ろの要素を詰めるため O(n)
+		size_t erase(std::string_view key) {
+			const size_t i = locate(key, key_hash(key), nullptr);
+			if(i == _entries.size()) return 0;
+			_entries.erase(_entries.begin() + i);
+			reindex();
+			return 1;
+		}
+
+		// std::map::merge と同様に, this に無い key の要素だけを other から移す
+		void merge(FlatMap &other) {
+			std::pmr::vector<value_type> rest(other._entries.get_allocator());
+			for(auto &entry : other._entries) {
+				const Key &key = entry.first;
+				if(locate(key, key.hash(), key.id()) < size())
+					rest.push_back(std::move(entry));
+				else
+					(*this)[std::move(entry.first)] = std::move(entry.second);
+			}
+			other._entries = std::move(rest);
+			other.reindex();
+		}
+	};
+
+	// key 順に反復するか
+	template <class M>
+	constexpr bool is_ordered = true;
+	template <class T>
+	constexpr bool is_ordered<FlatMap<T>> = false;
+
+}
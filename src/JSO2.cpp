@@ -1,162 +1,502 @@
 #include "JSO2.h"
 
+#include "Base64.h"
+#include "Builder.h"
+#include "MappedFile.h"
+#include "Number.h"
+#include "Sax.h"
+
+#include <bit>
 #include <cassert>
 #include <cctype>
 #include <cstring>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <algorithm>
 #include <limits>
 #include <numeric>
 #include <sstream>
+#include <stdexcept>
+#include <unordered_map>
 
 namespace JSO2 {
 
-	bool is_white_space(char c) {
-		switch(c) {
-			case ' ':		// space
-			case '\n':	// linefeed
-			case '\r':	// carriage return
-			case '\t':	// horizontal tab
-				return true;
-		}
-		return false;
+	void* allocate(std::pmr::memory_resource* arena, size_t size, size_t align) {
+		return arena ? arena->allocate(size, align) : ::operator new(size);
 	}
 
-	void skip_white_space(std::istream& src) {
-		while(is_white_space(src.peek())) src.get();
-	}
-
-	type detect_type(std::istream& src) {
-		skip_white_space(src);
-		switch(src.peek()) {
-			case '{':
-				return type::Object;
-			case '[':
-				return type::Array;
-			case '"':
-				return type::String;
-			case '-':
-			case '0':
-			case '1':
-			case '2':
-			case '3':
-			case '4':
-			case '5':
-			case '6':
-			case '7':
-			case '8':
-			case '9':
-				return type::Number;
-			case 't':
-				return type::True;
-			case 'f':
-				return type::False;
-			case 'n':
-				return type::Null;
-			default:
-				return type::TotalTypes;
-		}
-	}
+	type JSO2::get_type() const { return _t; }
 
-	bool is_one_nine(std::istream& src) {
-		return '1' <= src.peek() && src.peek() <= '9';
+	const JSO2::Object& JSO2::blank_object() {
+		static JSO2::Object dummy;
+		return dummy;
 	}
-
-	bool is_digit(std::istream& src) {
-		return '0' <= src.peek() && src.peek() <= '9';
+	const JSO2::Array& JSO2::blank_array() {
+		static JSO2::Array dummy;
+		return dummy;
 	}
-
-	JSO2 get_number(std::istream& src) {
-		std::string buffer;
-		if(src.peek() == '-') buffer.push_back(src.get());
-		if(is_one_nine(src)) {
-			buffer.push_back(src.get());
-			while(is_digit(src)) buffer.push_back(src.get());
-		} else if(src.peek() == '0')
-			buffer.push_back(src.get());
-		else
-			throw std::invalid_argument("Invalid sequence for Number\n");
-		if(src.peek() == '.') {
-			buffer.push_back(src.get());
-			while(is_digit(src)) buffer.push_back(src.get());
-		}
-		if(src.peek() == 'e' || src.peek() == 'E') {
-			buffer.push_back(src.get());
-			if(src.peek() == '+' || src.peek() == '-') buffer.push_back(src.get());
-			while(is_digit(src)) buffer.push_back(src.get());
-		}
-		return std::stod(buffer);
+	const JSO2::Null& JSO2::null() {
+		static JSO2::Null dummy;
+		return dummy;
 	}
 
-	JSO2 get_string(std::istream& src) {
-		std::string buffer;
-		if(src.peek() != '\"')
-			throw std::invalid_argument("Invalid sequence for String\n");
-		src.get();
-		while(1) {
-			if(src.peek() == '\"') return buffer;
-			if(src.peek() == '\\') { switch() }
+	void JSO2::release() {
+		// 子の container を先に取り外しておき, 深い木でも再帰せずに破棄する
+		auto detach = [](JSO2& node, std::vector<JSO2>& nested) {
+			auto is_container = [](const JSO2& v) {
+				return v._t == type::Object || v._t == type::Array;
+			};
+			if(node._t == type::Object) {
+				for(auto& [key, val] : node.ref<Object>())
+					if(is_container(val)) nested.emplace_back(std::move(val));
+			} else if(node._t == type::Array && !node.packed())
+				for(auto& val : node.ref<Array>())
+					if(is_container(val)) nested.emplace_back(std::move(val));
+		};
+
+		if(packed()) {
+			if(kind() == storage::heap)
+				delete field<Numbers*>();
+			else
+				field<Numbers*>()->~Numbers();
+			set(type::Value, storage::local);
+			return;
 		}
+		switch(_t) {
+			case type::Object:
+			case type::Array: {
+				std::vector<JSO2> nested;
+				detach(*this, nested);
+				while(!nested.empty()) {
+					JSO2 node(std::move(nested.back()));
+					nested.pop_back();
+					detach(node, nested);
+				}
+				if(_t == type::Object) {
+					if(kind() == storage::heap)
+						delete field<Object*>();
+					else
+						field<Object*>()->~Object();
+				} else {
+					if(kind() == storage::heap)
+						delete field<Array*>();
+					else
+						field<Array*>()->~Array();
+				}
+			} break;
+			case type::String:
+				if(kind() == storage::heap) delete field<String*>();
+				break;
+			default:
+				break;
+		}
+		set(type::Value, storage::local);
 	}
 
-	std::shared_ptr<void> pointer(type t) {
+	void JSO2::reset(type t) {
+		release();
 		switch(t) {
 			case type::Object:
-				return std::make_shared<std::map<std::string, std::shared_ptr<JSO2>>>();
+				store(new Object);
+				set(t, storage::heap);
+				break;
 			case type::Array:
-				return std::make_shared<std::vector<std::shared_ptr<JSO2>>>();
-			case type::String:
-				return std::make_shared<std::string>();
-			case type::Number:
-				return std::make_shared<double>();
-			case type::True:
-			case type::False:
-			case type::Null:
+				store(new Array);
+				set(t, storage::heap);
+				break;
 			default:
-				return nullptr;
+				store(Number(0));
+				set(t, storage::local);
+				break;
 		}
 	}
 
-	type JSO2::get_type() const { return _t; }
+	// 短い文字列は node 内に, それ以外は arena または heap に置く
+	void JSO2::assign(std::string_view str, std::pmr::memory_resource* arena) {
+		release();
+		if(str.size() <= local_capacity) {
+			std::memcpy(_v, str.data(), str.size());
+			set(type::String, storage::local, str.size());
+		} else if(arena && str.size() <= std::numeric_limits<uint32_t>::max()) {
+			char* data = (char*)arena->allocate(str.size(), 1);
+			std::memcpy(data, str.data(), str.size());
+			store<const char*>(data);
+			store<uint32_t>(str.size(), sizeof(const char*));
+			set(type::String, storage::arena);
+		} else {
+			store(new String(str));
+			set(type::String, storage::heap);
+		}
+	}
 
-	const JSO2::Object& JSO2::blank_object() {
-		static JSO2::Object dummy;
-		return dummy;
+	template <>
+	JSO2::Object& JSO2::ref<JSO2::Object>() const {
+		return *field<Object*>();
 	}
-	const JSO2::Array& JSO2::blank_array() {
-		static JSO2::Array dummy;
-		return dummy;
+	// 詰めた Array は numbers() で読む. const の参照では node を書き換えない
+	template <>
+	JSO2::Array& JSO2::ref<JSO2::Array>() const {
+		if(packed()) throw std::logic_error("JSO2 : packed array is read through numbers()\n");
+		return *field<Array*>();
 	}
-	const JSO2::Null& JSO2::null() {
-		static JSO2::Null dummy;
-		return dummy;
+
+	// 詰めた Array を同じ領域 (heap / arena) の通常の Array に展開する
+	void JSO2::unpack() {
+		if(!packed()) return;
+		Numbers* xs				= field<Numbers*>();
+		auto*		 resource = xs->get_allocator().resource();
+		Array*	 arr =
+				kind() == storage::heap
+						? new Array
+						: new(resource->allocate(sizeof(Array), alignof(Array))) Array(resource);
+		arr->reserve(xs->size());
+		for(double x : *xs) arr->emplace_back(x);
+		const storage s = kind();
+		release();
+		store(arr);
+		set(type::Array, s);
+	}
+
+	std::span<const double> JSO2::numbers() const {
+		assert(_t == type::Array);
+		if(!packed()) throw std::logic_error("JSO2 : not a packed array\n");
+		return *field<Numbers*>();
+	}
+	// node 内の短い文字列は参照された時点で heap に移す. arena 上や入力中の文字列は
+	// Document や入力が持つので動かさない
+	template <>
+	JSO2::String& JSO2::ref<JSO2::String>() const {
+		if(kind() == storage::local) {
+			JSO2*		self = const_cast<JSO2*>(this);
+			String* str	 = new String(view());
+			self->store(str);
+			self->set(type::String, storage::heap);
+		} else if(kind() != storage::heap)
+			throw std::logic_error("JSO2 : arena or borrowed string is read through view()\n");
+		return *field<String*>();
+	}
+	template <>
+	JSO2::Number& JSO2::ref<JSO2::Number>() const {
+		return field<Number>();
+	}
+
+	std::string_view JSO2::view() const {
+		assert(_t == type::String);
+		switch(kind()) {
+			case storage::local:
+				return {(const char*)_v, local_size()};
+			case storage::arena:
+			case storage::borrowed:
+				return {field<const char*>(), field<uint32_t>(sizeof(const char*))};
+			default:
+				return *field<String*>();
+		}
+	}
+
+	JSO2::JSO2() : _m(0), _t(type::Value) { store(Number(0)); }
+	// owned は arena の KeyPool の実体から heap に写した Key への表
+	template <class Map>
+	void copy_key(Map& obj, const typename Map::key_type& key,
+								std::unordered_map<const Atom::entry*, Key>& owned) {
+		if constexpr(is_ordered<Map>)
+			obj[key];
+		else if(key.id()->by == Atom::owner::pool) {
+			auto it = owned.find(key.id());
+			if(it == owned.end()) it = owned.emplace(key.id(), key).first;
+			obj[it->second];
+		} else
+			obj[key];
 	}
 
-	JSO2::JSO2() : _t(type::Value), _v(nullptr) {}
+	// 深い木でも再帰しないよう, 複製し終えていない子の組を stack に積む.
+	// arena の KeyPool の key は 1 度だけ heap に写し, 同じ key の Object で共有する
+	JSO2::JSO2(const JSO2& src) : JSO2() {
+		std::vector<std::pair<const JSO2*, JSO2*>>			 stack = {{&src, this}};
+		std::unordered_map<const Atom::entry*, Key>			 owned;
+		while(!stack.empty()) {
+			const auto [from, to] = stack.back();
+			stack.pop_back();
+			switch(from->_t) {
+				case type::Object: {
+					const Object& members = from->ref<Object>();
+					Object*				obj			= new Object;
+					to->store(obj);
+					to->set(type::Object, storage::heap);
+					for(const auto& [key, val] : members) copy_key(*obj, key, owned);
+					auto it = obj->begin();
+					for(const auto& member : members) stack.emplace_back(&member.second, &(it++)->second);
+				} break;
+				case type::Array:
+					if(from->packed()) {
+						to->store(new Numbers(*from->field<Numbers*>()));
+						to->set(type::Array, storage::heap, 1);
+					} else {
+						const Array& elements = from->ref<Array>();
+						Array*			 arr			= new Array(elements.size());
+						to->store(arr);
+						to->set(type::Array, storage::heap);
+						for(size_t i = 0; i < elements.size(); ++i) stack.emplace_back(&elements[i], &(*arr)[i]);
+					}
+					break;
+				case type::String:
+					if(from->kind() == storage::borrowed) {
+						std::memcpy(to->_v, from->_v, sizeof(_v));
+						to->set(type::String, storage::borrowed);
+					} else
+						to->assign(from->view(), nullptr);
+					break;
+				default:
+					std::memcpy(to->_v, from->_v, sizeof(_v));
+					to->set(from->_t, storage::local);
+					break;
+			}
+		}
+	}
+	JSO2::JSO2(JSO2&& src) noexcept : _m(src._m), _t(src._t) {
+		std::memcpy(_v, src._v, sizeof(_v));
+		src.set(type::Value, storage::local);
+	}
 	JSO2::JSO2(const Object& obj) : JSO2() { *this = obj; }
 	JSO2::JSO2(const Array& ary) : JSO2() { *this = ary; }
 	JSO2::JSO2(const String& str) : JSO2() { *this = str; }
 	JSO2::JSO2(const Number& x) : JSO2() { *this = x; }
-	JSO2::JSO2(const Null& x) : _t(type::Null), _v(nullptr) {}
-	JSO2::JSO2(std::istream& src) : _t(detect_type(src)), _v(pointer(_t)) {}
+	JSO2::JSO2(const Null&) : JSO2() { _t = type::Null; }
+	JSO2::JSO2(std::istream& src) : JSO2() { load(src); }
+	JSO2::~JSO2() { release(); }
+
+	void JSO2::swap(JSO2& other) noexcept {
+		std::swap(_v, other._v);
+		std::swap(_m, other._m);
+		std::swap(_t, other._t);
+	}
 
-	bool JSO2::load(std::istream& src) {
-		_t = detect_type(src);
-		_v = pointer(_t);
-		switch(_t) {
-			case type::Number:
-				*this = get_number(src);
-				return true;
+	JSO2& JSO2::operator=(const JSO2& src) {
+		if(this != &src) JSO2(src).swap(*this);
+		return *this;
+	}
+	JSO2& JSO2::operator=(JSO2&& src) noexcept {
+		if(this != &src) JSO2(std::move(src)).swap(*this);
+		return *this;
+	}
+
+	// stream の残りを全て読み込んでから解析し, seek 可能なら解析し終えた位置まで戻す
+	template <class F>
+	bool load_stream(std::istream& src, F&& load) {
+		const auto	start = src.tellg();
+		std::string text{std::istreambuf_iterator<char>(src),
+										 std::istreambuf_iterator<char>()};
+
+		const char* p		= text.data();
+		bool				ret = load(p, text.data() + text.size());
+
+		if(start != std::istream::pos_type(-1)) {
+			src.clear();
+			src.seekg(start + std::streamoff(p - text.data()));
+		}
+		return ret;
+	}
+
+	bool JSO2::load(std::istream& src, size_t max_depth) {
+		return load_stream(src, [&](const char*& p, const char* end) {
+			return load(p, end, max_depth);
+		});
+	}
+
+	bool JSO2::load(std::string_view src, size_t max_depth) {
+		const char* p = src.data();
+		return load(p, src.data() + src.size(), max_depth);
+	}
+
+	bool JSO2::load(const char*& p, const char* end, size_t max_depth) {
+		return load(p, end, max_depth, nullptr, false);
+	}
+
+	bool JSO2::load_borrowed(std::string_view src, size_t max_depth) {
+		const char* p = src.data();
+		return load(p, src.data() + src.size(), max_depth, nullptr, true);
+	}
+
+	void JSO2::materialize() { materialize(nullptr); }
+
+	void JSO2::materialize(std::pmr::memory_resource* arena) {
+		std::vector<JSO2*> stack = {this};
+		while(!stack.empty()) {
+			JSO2& node = *stack.back();
+			stack.pop_back();
+			switch(node._t) {
+				case type::Object:
+					for(auto& [key, val] : node.ref<Object>()) stack.push_back(&val);
+					break;
+				case type::Array:
+					if(!node.packed())
+						for(auto& val : node.ref<Array>()) stack.push_back(&val);
+					break;
+				case type::String:
+					if(node.kind() == storage::borrowed) node.assign(node.view(), arena);
+					break;
+				default:
+					break;
+			}
 		}
 	}
 
-#define reset_type(_type)                                        \
-	do {                                                           \
-		if(_t != type::_type) _v.reset(new _type), _t = type::_type; \
+	// Atom で引けない backend (std::pmr::map) は文字列で引く
+	template <class Map>
+	JSO2& find_or_insert(Map& obj, const Atom& key) {
+		if constexpr(is_ordered<Map>)
+			return obj[key.str()];
+		else
+			return obj[key];
+	}
+
+	// load した key は pool の実体をそのまま指す. std::pmr::map は文字列で持つので intern しない
+	template <class Map>
+	JSO2& insert_key(Map& obj, KeyPool& keys, std::string_view key) {
+		if constexpr(is_ordered<Map>)
+			return obj[typename Map::key_type(key)];
+		else
+			return obj[Key::borrow(keys.intern(key))];
+	}
+
+	JSO2& JSO2::builder::slot() {
+		if(stack.empty()) return root;
+		JSO2& top = *stack.back();
+		if(top._t == type::Object) return *member;
+		if(undecided) {
+			make<Array>(top, type::Array);
+			undecided = false;
+		} else
+			top.unpack();
+		return top.ref<Array>().emplace_back();
+	}
+
+	template <class T>
+	void JSO2::builder::make(JSO2& s, type t, size_t layout) {
+		s.store(new(allocate(arena, sizeof(T), alignof(T)))
+								T(arena ? arena : std::pmr::get_default_resource()));
+		s.set(t, arena ? storage::arena : storage::heap, layout);
+	}
+
+	void JSO2::builder::on_object_begin() {
+		JSO2& s = slot();
+		make<Object>(s, type::Object);
+		stack.push_back(&s);
+	}
+	// Array の形は最初の要素で決める. 数なら Numbers に詰め, 後に数以外が来れば slot() が展開する
+	void JSO2::builder::on_array_begin() {
+		stack.push_back(&slot());
+		undecided = true;
+	}
+	void JSO2::builder::on_array_end() {
+		if(undecided) {
+			make<Array>(*stack.back(), type::Array);
+			undecided = false;
+		}
+		stack.pop_back();
+	}
+	void JSO2::builder::on_key(std::string_view key) {
+		Object& obj = stack.back()->ref<Object>();
+		member			= &insert_key(obj, *keys, key);
+		*member			= JSO2();
+	}
+	void JSO2::builder::on_string(std::string_view str) {
+		JSO2& s = slot();
+		// エスケープを含まない文字列は sax::get_string が入力の中を指して渡す.
+		// 別の領域の pointer と比べることになるので std::less で全順序を使う
+		const std::less<const char*> before;
+		if(first && !before(str.data(), first) && before(str.data(), last) &&
+			 str.size() > local_capacity && str.size() <= std::numeric_limits<uint32_t>::max()) {
+			s.release();
+			s.store(str.data());
+			s.store<uint32_t>(str.size(), sizeof(const char*));
+			s.set(type::String, storage::borrowed);
+		} else
+			s.assign(str, arena);
+	}
+	void JSO2::builder::on_number(double x) {
+		if(undecided) {
+			make<Numbers>(*stack.back(), type::Array, 1);
+			undecided = false;
+		}
+		if(!stack.empty() && stack.back()->packed())
+			stack.back()->field<Numbers*>()->push_back(x);
+		else
+			slot() = x;
+	}
+	void JSO2::builder::on_numbers(const sax::block& b) {
+		sax::decode_block(b, on_numbers(b.size));
+	}
+	double* JSO2::builder::on_numbers(size_t n) {
+		JSO2& s = slot();
+		make<Numbers>(s, type::Array, 1);
+		Numbers& xs = *s.field<Numbers*>();
+		xs.resize(n);
+		return xs.data();
+	}
+
+	bool JSO2::load(const char*& p, const char* end, size_t max_depth,
+									std::pmr::memory_resource* arena, bool borrow, KeyPool* keys) {
+		builder b(arena, borrow ? p : nullptr, borrow ? end : nullptr, keys);
+		if(!sax::parse(p, end, b, max_depth)) return false;
+		*this = std::move(b.root);
+		return true;
+	}
+
+	bool JSO2::load_file(const std::string& path, size_t max_depth) {
+		MappedFile file(path);
+		return load(file.view(), max_depth);
+	}
+
+	Document::Document() : _keys(&_arena) {}
+	Document::Document(size_t initial_size) : _arena(initial_size), _keys(&_arena) {}
+
+	// 木と key の表を arena より先に捨てる
+	void Document::reset() {
+		_root = JSO2();
+		_keys.clear();
+		_arena.release();
+	}
+
+	JSO2 Document::detach() {
+		JSO2 ret = _root;
+		ret.materialize();
+		reset();
+		return ret;
+	}
+
+	bool Document::load(std::istream& src, size_t max_depth) {
+		return load_stream(src, [&](const char*& p, const char* end) {
+			reset();
+			return _root.load(p, end, max_depth, &_arena, false, &_keys);
+		});
+	}
+
+	bool Document::load(std::string_view src, size_t max_depth) {
+		const char* p = src.data();
+		reset();
+		return _root.load(p, src.data() + src.size(), max_depth, &_arena, false, &_keys);
+	}
+
+	bool Document::load_borrowed(std::string_view src, size_t max_depth) {
+		const char* p = src.data();
+		reset();
+		return _root.load(p, src.data() + src.size(), max_depth, &_arena, true, &_keys);
+	}
+
+	bool Document::load_file(const std::string& path, size_t max_depth) {
+		MappedFile file(path);
+		return load(file.view(), max_depth);
+	}
+
+#define reset_type(_type)                     \
+	do {                                        \
+		if(_t != type::_type) reset(type::_type); \
 	} while(0)
 #define validate_type(_type) \
-	do { assert(_t != type::_type); } while(0)
-#define as(_type) (*(_type*)_v.get())
+	do { assert(_t == type::_type); } while(0)
+#define as(_type) ref<_type>()
 #define asign(_type)                        \
 	JSO2& JSO2::operator=(const _type& val) { \
 		reset_type(_type);                      \
@@ -165,16 +505,27 @@ namespace JSO2 {
 	}
 
 	asign(Object);
-	asign(Array);
-	asign(String);
 	asign(Number);
 #undef asign
+	JSO2& JSO2::operator=(const Array& val) {
+		reset_type(Array);
+		unpack();
+		as(Array) = val;
+		return *this;
+	}
+	JSO2& JSO2::operator=(const String& str) {
+		if(_t == type::String && kind() == storage::heap)
+			*field<String*>() = str;
+		else
+			assign(str, nullptr);
+		return *this;
+	}
 	JSO2& JSO2::operator=(const char* str) {
 		return this->operator=(std::string(str));
 	}
 	JSO2& JSO2::operator=(int i) { return this->operator=((double)i); }
 	JSO2& JSO2::operator=(bool b) {
-		_v.reset();
+		release();
 		if(b)
 			_t = type::True;
 		else {
@@ -183,18 +534,34 @@ namespace JSO2 {
 		return *this;
 	}
 	JSO2& JSO2::operator=(const Null&) {
-		_v.reset();
+		release();
 		_t = type::Null;
 		return *this;
 	}
 
+	JSO2& JSO2::operator=(std::span<const double> xs) {
+		Numbers* copy = new Numbers(xs.begin(), xs.end());
+		release();
+		store(copy);
+		set(type::Array, storage::heap, 1);
+		return *this;
+	}
+
 	JSO2& JSO2::operator[](const String& key) {
 		reset_type(Object);
 		return as(Object)[key];
 	}
+	// const の参照では要素を足さない. 無い key は std::out_of_range
+	template <class Map, class Key>
+	const JSO2& find_or_throw(const Map& obj, const Key& key) {
+		auto it = obj.find(key);
+		if(it == obj.end()) throw std::out_of_range("JSO2 : no such key\n");
+		return it->second;
+	}
+
 	const JSO2& JSO2::operator[](const String& key) const {
 		validate_type(Object);
-		return as(Object)[key];
+		return find_or_throw(as(Object), key);
 	}
 
 	JSO2& JSO2::operator[](const char* key) {
@@ -204,15 +571,33 @@ namespace JSO2 {
 		return this->operator[](std::string(key));
 	}
 
-	JSO2& JSO2::operator[](int index) {
+	JSO2& JSO2::operator[](const Atom& key) {
+		reset_type(Object);
+		return find_or_insert(as(Object), key);
+	}
+	const JSO2& JSO2::operator[](const Atom& key) const {
+		validate_type(Object);
+		if constexpr(is_ordered<Object>)
+			return find_or_throw(as(Object), key.str());
+		else
+			return find_or_throw(as(Object), key);
+	}
+
+	// Array でなければ load と同じく詰めた Array から始め, 数を代入する間は詰めたままにする.
+	// 詰めた Array を伸ばした要素は 0
+	JSO2::element JSO2::operator[](int index) {
 		assert(index >= 0);
-		reset_type(Array);
-		as(Array).resize(std::max(size_t(index + 1), as(Array).size()));
-		return as(Array)[index];
+		if(_t != type::Array) *this = std::span<const double>();
+		if(packed()) {
+			Numbers& xs = *field<Numbers*>();
+			xs.resize(std::max(size_t(index + 1), xs.size()));
+		} else
+			as(Array).resize(std::max(size_t(index + 1), as(Array).size()));
+		return element(this, index);
 	}
-	const JSO2& JSO2::operator[](int index) const {
+	JSO2::const_element JSO2::operator[](int index) const {
 		validate_type(Array);
-		return as(Array)[index];
+		return const_element(this, index);
 	}
 
 #define conv(_type)                     \
@@ -226,16 +611,39 @@ namespace JSO2 {
 	}
 
 	conv(Object);
-	conv(Array);
-	conv(String);
 	conv(Number);
 #undef conv
+	JSO2::operator const Array&() const {
+		assert(get_type() == type::Array);
+		return as(Array);
+	}
+	// 詰めた Array は変更できる参照を取った時点で展開する
+	JSO2::operator Array&() {
+		assert(get_type() == type::Array);
+		unpack();
+		return as(Array);
+	}
+	JSO2::operator const String&() const {
+		assert(get_type() == type::String);
+		return as(String);
+	}
+	// node 内や arena 上の文字列は std::string として参照された時点で heap に複製する
+	JSO2::operator String&() {
+		assert(get_type() == type::String);
+		if(kind() != storage::heap) {
+			String* str = new String(view());
+			store(str);
+			set(type::String, storage::heap);
+		}
+		return *field<String*>();
+	}
 	JSO2::operator bool() const {
 		assert(_t == type::True || _t == type::False);
 		if(_t == type::True) return true;
 		return false;
 	}
 
+
 	class tab {
 		// IntManiac を受け入れる挿入演算子 << の定義
 		friend std::ostream& operator<<(std::ostream& dest, tab intmaniac) {
@@ -255,703 +663,420 @@ namespace JSO2 {
 		}
 	};
 
-	void output(std::ostream& dest, const JSO2& jso2, size_t level) {
-		switch(jso2.get_type()) {
-			case type::Object: {
-				dest << "{\n";
-				size_t len = 0;
-				for(const auto& [key, val] : (const JSO2::Object&)jso2)
-					len = std::max(len, key.length());
-				size_t index = 0;
-				for(const auto& [key, val] : (const JSO2::Object&)jso2) {
-					dest << tab(level + 1) << std::left << std::setw(len + 2)
-							 << "\"" + key + "\""
-							 << " : ";
-					output(dest, val, level + 1);
-					dest << (++index < ((const JSO2::Object&)jso2).size() ? "," : "");
-					dest << "\n";
-				}
-				dest << tab(level) << "}";
-			} break;
-			case type::Array: {
-				dest << "[\n";
-				size_t index = 0;
-				for(const auto& val : (const JSO2::Array&)jso2) {
-					dest << tab(level + 1);
-					output(dest, val, level + 1);
-					dest << (++index < ((const JSO2::Array&)jso2).size() ? "," : "");
-					dest << "\n";
-				}
-				dest << tab(level) << "]";
-			} break;
-			case type::String:
-				dest << "\"" << (JSO2::String)jso2 << "\"";
-				break;
-			case type::Number:
-				dest << (JSO2::Number)jso2;
-				break;
-			case type::True:
-				dest << "true";
-				break;
-			case type::False:
-				dest << "false";
-				break;
-			case type::Null:
-				dest << "null";
-				break;
-			default:
-				dest << "Error: undefined type!";
-				break;
+	// hex_bits なら bit をそのまま 16 進で書く. そうでなく std::fixed / std::scientific が
+	// 指定されていなければ, stream の精度によらず, 読み戻して一致する最短の表記で書く
+	void write_number(std::ostream& dest, double x, style s) {
+		if(s & style::hex_bits) {
+			char buf[number::hex_length];
+			dest.write(buf, number::format_hex(buf, x) - buf);
+			return;
 		}
-	}
-
-	std::ostream& operator<<(std::ostream& dest, const JSO2& jso2) {
-		output(dest, jso2, 0);
-		return dest;
-	}
-
-	/*
-#define fault(name)                                     \
-	do {                                                  \
-		std::cerr << "# JSON : parse error in " #name "\n"; \
-		std::cerr << "# >>>>";                              \
-		std::cerr << buffer;                                \
-		std::cerr << "<<<<\n";                              \
-		return nullptr;                                     \
-	} while(false)
-
-#define dequeue(name)                 \
-	do {                                \
-		if(type::name == type::String) {  \
-			if(src)                         \
-				buffer.push_back(src.get());  \
-			else {                          \
-				fault(name);                  \
-			}                               \
-		} else {                          \
-			if(src) {                       \
-				if(src.peek() == '#')         \
-					while(src.peek() != '\n') { \
-						if(src)                   \
-							src.get();              \
-						else                      \
-							fault(name);            \
-					}                           \
-				buffer.push_back(src.get());  \
-			} else {                        \
-				fault(name);                  \
-			}                               \
-		}                                 \
-	} while(false)
-
-	bool is_white_space(char c) {
-		switch(c) {
-			case ' ':		// space
-			case '\n':	// linefeed
-			case '\r':	// carriage return
-			case '\t':	// horizontal tab
-				return true;
+		if(dest.flags() & std::ios::floatfield) {
+			dest << x;
+			return;
 		}
-		return false;
-	}
-
-	std::ostream &operator<<(std::ostream &dest, const Value &val) {
-		val.print(dest);
-		return dest;
+		char buf[number::max_length];
+		dest.write(buf, number::format(buf, x) - buf);
 	}
 
-	bool is_one_nine(char c) { return '1' <= c && c <= '
-JSON(std::istream& src); 9'; }
-
-	bool is_digit(char c) { return '0' <= c && c <= '9'; }
-
-	std::shared_ptr<Value> Value::parse(std::istream &src) {
-		buffer.clear();
-		while(is_white_space(src.peek())) dequeue(Value);
-		std::shared_ptr<Value> val;
-		switch(src.peek()) {
-			case '\"':
-				val = String::parse(src);
-				break;
-			case '{':
-				val = Object::parse(src);
-				break;
-			case '[':
-				val = Array::parse(src);
-				break;
-			case 't':
-				val = True::parse(src);
-				break;
-			case 'f':
-				val = False::parse(src);
-				break;
-			case 'n':
-				val = Null::parse(src);
-				break;
-			case '-':
-			default:
-				if(is_digit(src.peek())) val = Number::parse(src);
-		}
-		if(!val) fault(Value);
-
-		while(is_white_space(src.peek())) dequeue(Value);
-
-		return std::shared_ptr<Value>(val);
-	}
-
-	std::string Value::buffer;
-
-	std::shared_ptr<String> String::parse(std::istream &src) {
-		buffer.clear();
-
-		if(src && src.peek() != '"') return nullptr;
-		src.get();
-
-		do {
-			dequeue(String);
-
-			if(buffer.back() == '\"') {
-				buffer.pop_back();
-				return std::make_shared<String>(buffer);
-			} else if(buffer.back() == '\\') {
-				dequeue(String);
-				switch(buffer.back()) {
-#define push(c)      \
-	buffer.pop_back(); \
-	buffer.pop_back(); \
-	buffer.push_back(c);
-					case '"':
-						push('\"');
-						break;
-					case '\\':
-						push('\\');
-						break;
-					case '/':
-						push('/');
-						break;
-					case 'b':
-						push('\b');
-						break;
-					case 'f':
-						push('\f');
-						break;
-					case 'n':
-						push('\n');
-						break;
-					case 'r':
-						push('\r');
-						break;
-					case 't':
-						push('\t');
-						break;
-#undef push
-					default:
-						fault(String);
-						return nullptr;
-				}
+	// 数だけの空でない Array を sax::get_block の形 ("@f64(" + base64 + ")") で書く.
+	// 数以外を含む Array と空の Array は書かずに false を返す.
+	template <class Out>
+	bool write_block(Out& out, const JSO2& node) {
+		std::span<const double> xs;
+		std::vector<double>			copy;
+		if(node.packed())
+			xs = node.numbers();
+		else {
+			for(const auto& val : (const JSO2::Array&)node) {
+				if(val.get_type() != type::Number) return false;
+				copy.push_back((const JSO2::Number&)val);
 			}
-		} while(1);
-	}
-
-	void String::print(std::ostream &dest, size_t) const {
-		dest << "\"" << static_cast<std::string>(*this) << "\"";
-	};
-
-	std::shared_ptr<Number> Number::parse(std::istream &src) {
-		buffer.clear();
-
-		if(src.peek() == '-') dequeue(Number);
-
-		if(src.peek() == '0')
-			dequeue(Number);
-		else if(is_one_nine(src.peek())) {
-			dequeue(Number);
-			while(is_digit(src.peek())) dequeue(Number);
-		} else
-			fault(Number);
-
-		if(src.peek() == '.') {
-			dequeue(Number);
-			while(is_digit(src.peek())) dequeue(Number);
+			xs = copy;
 		}
-		if(src.peek() == 'e' || src.peek() == 'E') {
-			dequeue(Number);
-			if(src.peek() == '-' || src.peek() == '+') dequeue(Number);
-			if(!is_digit(src.peek()))
-				fault(Number);
-			else
-				while(is_digit(src.peek())) dequeue(Number);
+		if(xs.empty()) return false;
+		out.write("@f64(", 5);
+		// 3 の倍数の byte ずつ符号化すれば途中に '=' が入らない
+		constexpr size_t chunk = 48;
+		unsigned char		 bytes[chunk * 8];
+		char						 text[base64::encoded_length(sizeof(bytes))];
+		for(size_t i = 0; i < xs.size(); i += chunk) {
+			const size_t n = std::min(chunk, xs.size() - i);
+			for(size_t k = 0; k < n; ++k) {
+				uint64_t bits = std::bit_cast<uint64_t>(xs[i + k]);
+				if constexpr(std::endian::native == std::endian::big) bits = __builtin_bswap64(bits);
+				std::memcpy(bytes + 8 * k, &bits, 8);
+			}
+			out.write(text, base64::encode(text, bytes, 8 * n) - text);
 		}
-		return std::make_shared<Number>(std::stod(buffer));
+		out.write(")", 1);
+		return true;
 	}
 
-	void Number::print(std::ostream &dest, size_t) const { dest << val; }
-
-	bool is_hex(char c) {
-		return ('0' <= c && c <= '9') || ('A' <= c && c <= 'F');
+	// sorted なら, key 順に並んでいない Object の要素を並べ替える
+	template <class Iterator>
+	void sort_by_key(Iterator first, Iterator last, bool sorted) {
+		if(is_ordered<JSO2::Object> || !sorted) return;
+		std::sort(first, last, [](const auto* a, const auto* b) { return a->first < b->first; });
 	}
 
-	int from_hex(char c) { return '0' <= c && c <= '9' ? c - '0' : c - 'A' +
-10; } char to_hex(int n) { n &= 15; return n < 10 ? n + '0' : n - 10 +
-'A';
+	// operator<< に効く style の bit (sorted, hex_bits, packed) を置く stream の場所
+	long& output_style(std::ostream& dest) {
+		static const int index = std::ios_base::xalloc();
+		return dest.iword(index);
 	}
 
-	double double_from_binary_string(const std::string &str) {
-		uint64_t binary = 0;
-		double	 x;
-
-		if(str.size() < 16) return std::numeric_limits<double>::quiet_NaN();
-
-		for(size_t i = 0; i < 16; ++i) {
-			if(!is_hex(str[i])) return std::numeric_limits<double>::quiet_NaN();
-			binary <<= 4;
-			binary |= (from_hex(str[i]) & 15);
-		}
-		memcpy(&x, &binary, sizeof(double));
-		return x;
+	std::ostream& sorted_keys(std::ostream& dest) {
+		output_style(dest) |= long(style::sorted);
+		return dest;
 	}
 
-	std::string binary_string_from_double(double x) {
-		uint64_t binary;
-
-		std::memcpy(&binary, &x, sizeof(double));
-		char buf[17] = {};
-		for(size_t i = 0; i < 16; ++i) {
-			buf[15 - i] = to_hex(binary);
-			binary >>= 4;
-		}
-		return buf;
+	std::ostream& insertion_order(std::ostream& dest) {
+		output_style(dest) &= ~long(style::sorted);
+		return dest;
 	}
 
-	std::shared_ptr<Object> Object::parse(std::istream &src) {
-		buffer.clear();
-
-		if(src.peek() != '{') fault(Object);
-		dequeue(Object);
-
-		std::shared_ptr<Object> ret(new Object);
-
-		while(1) {
-			while(is_white_space(src.peek())) dequeue(Object);
-			if(src.peek() == '}') {
-				dequeue(Object);
-				return ret;
-			}
-			std::shared_ptr<String> p_key(String::parse(src));
-
-			if(!p_key) fault(Object);
-
-			while(is_white_space(src.peek())) dequeue(Object);
-
-			if(src.peek() != ':') fault(Object);
-			dequeue(Object);
-
-			std::shared_ptr<Value> p_value = Value::parse(src);
-
-			if(!p_value) fault(Object);
-
-			if(ret->contains((std::string)*p_key)) {
-				std::cerr << "# warning : key \"" << (std::string)*p_key
-									<< "\" already contained.\n";
-				std::cerr << "# The previous one is ignored.\n";
-			}
-
-			(*ret)[(std::string)*p_key] = p_value;
-
-			if(src.peek() == '}') {
-				dequeue(Object);
-				return ret;
-			}
-
-			if(src.peek() != ',') fault(Object);
-			dequeue(Object);
-		}
+	std::ostream& hex_numbers(std::ostream& dest) {
+		output_style(dest) |= long(style::hex_bits);
+		return dest;
 	}
 
-	void Object::print(std::ostream &dest, size_t level) const {
-		std::string tab(level, '\t');
-
-		size_t max_key_len = 0;
-		for(const auto &[key, _] : *this)
-			max_key_len = std::max(max_key_len, key.length());
-
-		dest << "{\n";
-		if(size() != 0)
-			for(auto iter = begin();;) {
-				const auto &[key, p_val] = *iter;
-				dest << tab << "\t" << std::setw(max_key_len + 2) << std::left
-						 << "\"" + key + "\""
-						 << " : ";
-				p_val->print(dest, level + 1);
-				if(++iter == end()) {
-					dest << "\n";
-					break;
-				} else
-					dest << ",\n";
-			}
-		dest << tab << "}";
+	std::ostream& decimal_numbers(std::ostream& dest) {
+		output_style(dest) &= ~long(style::hex_bits);
+		return dest;
 	}
 
-	std::shared_ptr<Array> Array::parse(std::istream &src) {
-		buffer.clear();
-
-		if(src.peek() != '[') fault(Array);
-		dequeue(Array);
-
-		while(is_white_space(src.peek())) dequeue(Array);
+	std::ostream& packed_arrays(std::ostream& dest) {
+		output_style(dest) |= long(style::packed);
+		return dest;
+	}
 
-		std::shared_ptr<Array> ret(new Array);
+	std::ostream& plain_arrays(std::ostream& dest) {
+		output_style(dest) &= ~long(style::packed);
+		return dest;
+	}
 
-		while(1) {
-			if(src.peek() == ']') {
-				dequeue(Array);
-				return ret;
+	// serialize() と同じく, 開いている container ごとに次に書く要素の位置を stack に積み,
+	// 深い木でも再帰せずに書く
+	void output(std::ostream& dest, const JSO2& root, style s) {
+		const bool sorted = s & style::sorted;
+
+		struct frame {
+			const JSO2* node;
+			size_t			first;
+			size_t			next;	 // 次に書く要素
+			size_t			last;
+			size_t			width;	// 揃える key の幅
+		};
+		std::vector<frame>														stack;
+		std::vector<const JSO2::Object::value_type*> members;
+
+		auto open = [&](const JSO2& node) {
+			switch(node.get_type()) {
+				case type::Object: {
+					const size_t first = members.size();
+					size_t			 len	 = 0;
+					for(const auto& member : (const JSO2::Object&)node) {
+						members.push_back(&member);
+						len = std::max(len, std::string_view(member.first).length());
+					}
+					sort_by_key(members.begin() + first, members.end(), sorted);
+					dest << "{\n";
+					stack.push_back({&node, first, first, members.size(), len});
+				} break;
+				case type::Array:
+					if((s & style::packed) && write_block(dest, node)) break;
+					dest << "[\n";
+					stack.push_back({&node, 0, 0,
+													 node.packed() ? node.numbers().size()
+																				 : ((const JSO2::Array&)node).size(),
+													 0});
+					break;
+				case type::String:
+					dest << "\"" << node.view() << "\"";
+					break;
+				case type::Number:
+					write_number(dest, (JSO2::Number)node, s);
+					break;
+				case type::True:
+					dest << "true";
+					break;
+				case type::False:
+					dest << "false";
+					break;
+				case type::Null:
+					dest << "null";
+					break;
+				default:
+					dest << "Error: undefined type!";
+					break;
 			}
-
-			std::shared_ptr<Value> p_value = Value::parse(src);
-
-			if(!p_value) fault(Array);
-
-			ret->push_back(p_value);
-
-			if(src.peek() == ']') {
-				dequeue(Array);
-				return ret;
+		};
+
+		open(root);
+		while(!stack.empty()) {
+			frame&			 f				 = stack.back();
+			const size_t level		 = stack.size();
+			const bool	 is_object = f.node->get_type() == type::Object;
+			if(f.next == f.last) {
+				if(f.first != f.last) dest << "\n";
+				dest << tab(level - 1) << (is_object ? "}" : "]");
+				if(is_object) members.resize(f.first);
+				stack.pop_back();
+				continue;
 			}
-
-			if(src.peek() != ',') fault(Object);
-			dequeue(Array);
+			if(f.next != f.first) dest << ",\n";
+			dest << tab(level);
+			if(is_object) {
+				const auto& [key, val] = *members[f.next++];
+				dest << std::left << std::setw(f.width + 2) << "\"" + std::string(key) + "\""
+						 << " : ";
+				open(val);
+			} else if(f.node->packed())
+				write_number(dest, f.node->numbers()[f.next++], s);
+			else
+				open(((const JSO2::Array&)*f.node)[f.next++]);
 		}
 	}
 
-	void Array::print(std::ostream &dest, size_t level) const {
-		std::string tab(level, '\t');
-
-		dest << "[\n";
-		for(auto iter = begin();;) {
-			const auto p_val = *iter;
-			dest << tab << "\t";
-			p_val->print(dest, level + 1);
-			if(++iter == end()) {
-				dest << "\n";
-				break;
-			} else
-				dest << ",\n";
-		}
-		dest << tab << "]";
+	std::ostream& operator<<(std::ostream& dest, const JSO2& jso2) {
+		output(dest, jso2, style(output_style(dest)));
+		return dest;
 	}
-
-	std::shared_ptr<True> True::parse(std::istream &src) {
-		buffer.clear();
-		for(size_t i = 0; i < 4; ++i) {
-			dequeue(True);
-			if(buffer.back() != "true"[i]) fault(True);
-		}
-		return std::make_shared<True>();
+	// 詰めた Array の要素は数 1 つの node に写して書く
+	std::string JSO2::const_element::dump(style s) const {
+		if(const Number* x = number()) return JSO2(*x).dump(s);
+		return get().dump(s);
 	}
-
-	void True::print(std::ostream &dest, size_t) const { dest << "true"; }
-
-	std::shared_ptr<False> False::parse(std::istream &src) {
-		buffer.clear();
-		for(size_t i = 0; i < 5; ++i) {
-			dequeue(False);
-			if(buffer.back() != "false"[i]) fault(False);
-		}
-		return std::make_shared<False>();
+	void JSO2::const_element::serialize_to(std::string& dest, style s) const {
+		if(const Number* x = number())
+			JSO2(*x).serialize_to(dest, s);
+		else
+			get().serialize_to(dest, s);
+	}
+	size_t JSO2::const_element::serialize_to(char* buf, size_t size, style s) const {
+		if(const Number* x = number()) return JSO2(*x).serialize_to(buf, size, s);
+		return get().serialize_to(buf, size, s);
+	}
+	std::ostream& operator<<(std::ostream& dest, const JSO2::const_element& elem) {
+		if(elem.get_type() == type::Number) return dest << JSO2((const JSO2::Number&)elem);
+		return dest << elem.get();
 	}
 
-	void False::print(std::ostream &dest, size_t) const { dest << "false"; }
-
-	std::shared_ptr<Null> Null::parse(std::istream &src) {
-		buffer.clear();
-		for(size_t i = 0; i < 4; ++i) {
-			dequeue(True);
-			if(buffer.back() != "null"[i]) fault(True);
-		}
-		return std::make_shared<Null>();
-	}
-
-	void Null::print(std::ostream &dest, size_t) const { dest << "null"; }
-
-#undef pop
-#undef fault
-
-	/*
-	namespace v1 {
-
-	#define fault           \
-	do {                \
-		next = begin;   \
-		return nullptr; \
-	} while(false)
-
-	#define advance           \
-	do {                  \
-		if(++next == end) \
-			fault;        \
-	} while(false)
-
-		Value *Value::parse(const std::string &str, size_t begin, size_t end,
-size_t &next) { while(isspace(str[next])) advance;
-
-			Value *ret = nullptr;
-			if((ret = String::parse(str, next, end, next)))
-				;
-			else if((ret = Number::parse(str, next, end, next)))
-				;
-			else if((ret = Object::parse(str, next, end, next)))
-				;
-			else if((ret = Array::parse(str, next, end, next)))
-				;
-			else if((ret = True::parse(str, next, end, next)))
-				;
-			else if((ret = False::parse(str, next, end, next)))
-				;
-			else if((ret = Null::parse(str, next, end, next)))
-				;
-			else {
-				std::cerr << "# JSON parsing error.\n";
-				std::cerr << "# >>>>>>";
-				std::cerr << str.substr(begin, end - begin);
-				std::cerr << "# <<<<<";
-				fault;
-			}
-
-			//		std::cerr << ">>>> Parse result : " << (int)ret->type_id() <<
-"\n";
-			//		std::cerr << str.substr(begin, next - begin) << "\n";
-			//		std::cerr << "Parse result : " << (int)ret->type_id() <<
-"<<<<<\n";
-
-			while(isspace(str[next])) advance;
-
-			return ret;
-		}
-
-		String *String::parse(const std::string &str, size_t begin, size_t
-end, size_t &next) { next = begin; if(str[next] != '\"') fault;
-
-			advance;
-
-			while(str[next] != '\"')
-				advance;
-			advance;
-
-			return new String(str, begin, next);
-
-			return nullptr;
-		}
-
-		String::String(const std::string &str, size_t begin, size_t end) :
-str(str, begin, end - begin) {}
-
-		std::string String::to_string() const {
-			return str;
-		}
-		void String::print(std::ostream &dest, size_t) const {
-			dest << str;
-		}
-
-		bool is_one_nine(char c) {
-			return '1' <= c && c <= '9';
-		}
+	std::ostream& operator<<(std::ostream& dest, const Document& doc) {
+		return dest << doc.root();
+	}
 
-		bool is_digit(char c) {
-			return '0' <= c && c <= '9';
-		}
+	// serialize の書き込み先. std::string に追記する
+	class string_sink {
+		std::string& dest;
 
-		Number *Number::parse(const std::string &str, size_t begin, size_t
-end, size_t &next) { next = begin; if(str[next] == '-') advance;
+	public:
+		string_sink(std::string& dest) : dest(dest) {}
+		void write(const char* s, size_t n) { dest.append(s, n); }
+		void put(char c) { dest.push_back(c); }
+		void fill(size_t n, char c) { dest.append(n, c); }
+	};
 
-			if(str[next] == '0')
-				advance;
-			else if(is_one_nine(str[next]))
-				do
-					advance;
-				while(is_digit(str[next]));
-			else
-				fault;
-
-			if(str[next] == '.')
-				do
-					advance;
-				while(is_digit(str[next]));
-
-			if(str[next] == 'e' || str[next] == 'E') {
-				advance;
-				if(str[next] == '+' || str[next] == '-')
-					advance;
-				while(is_digit(str[next]))
-					advance;
-			}
+	// 固定長の領域に書ける分だけ書き, 全体の長さを数える
+	class buffer_sink {
+		char*	 p;
+		size_t room;
+		size_t count = 0;
 
-			return new Number(str, begin, next);
+	public:
+		buffer_sink(char* buf, size_t size) : p(buf), room(size) {}
+		size_t size() const { return count; }
+		void	 write(const char* s, size_t n) {
+			 const size_t k = std::min(n, room);
+			 std::memcpy(p, s, k);
+			 p += k, room -= k, count += n;
 		}
-
-		Number::Number(const std::string &str, size_t begin, size_t end) :
-str(str, begin, end - begin) {}
-
-		std::string Number::to_string() const { return str; }
-		void		Number::print(std::ostream &dest, size_t) const {
-				 dest << str;
+		void put(char c) { write(&c, 1); }
+		void fill(size_t n, char c) {
+			const size_t k = std::min(n, room);
+			std::memset(p, c, k);
+			p += k, room -= k, count += n;
 		}
+	};
 
-		Object *Object::parse(const std::string &str, size_t begin, size_t
-end, size_t &next) { next = begin;
-
-			if(str[next] != '{')
-				fault;
-			advance;
-
-			std::unique_ptr<Object> ret(new Object);
-
-			do {
-				while(isspace(str[next]))
-					advance;
+	// escape が必要な文字 : '"', '\\' と制御文字
+	bool needs_escape(unsigned char c) { return c < 0x20 || c == '"' || c == '\\'; }
+
+	size_t quoted_length(std::string_view str) {
+		size_t n = str.size() + 2;
+		for(unsigned char c : str)
+			if(needs_escape(c))
+				n += c == '"' || c == '\\' || c == '\b' || c == '\f' || c == '\n' ||
+										 c == '\r' || c == '\t'
+								 ? 1
+								 : 5;
+		return n;
+	}
 
-				if(str[next] == '}')
+	template <class Sink>
+	void write_string(Sink& out, std::string_view str) {
+		out.put('"');
+		const char* run = str.data();
+		const char* end = run + str.size();
+		for(const char* p = run; p < end; ++p) {
+			if(!needs_escape(*p)) continue;
+			out.write(run, p - run);
+			run = p + 1;
+			switch(*p) {
+				case '"':
+					out.write("\\\"", 2);
 					break;
-
-				std::unique_ptr<String> p_key(String::parse(str, next, end,
-next));
-
-				if(p_key == nullptr)
-					fault;
-
-				while(isspace(str[next]))
-					advance;
-
-				if(str[next] != ':')
-					fault;
-
-				advance;
-
-				if(Value *p_val = Value::parse(str, next, end, next); p_val)
-					ret->data.emplace(p_key->to_string(), p_val);
-
-				if(str[next] == ',')
-					advance;
-				else if(str[next] == '}')
+				case '\\':
+					out.write("\\\\", 2);
 					break;
-				else
-					fault;
-			} while(true);
-
-			if(++next > end)
-				fault;
-			return ret.release();
-		}
-
-		Object::~Object() {
-			for(auto &[key, p_val] : data) delete p_val;
-		}
-
-		std::string Object::to_string() const {
-			std::stringstream dest;
-			print(dest, 0);
-			return dest.str();
-		}
-
-		void Object::print(std::ostream &dest, size_t level) const {
-			size_t max_key_size = 0;
-			for(const auto &[key, value] : data)
-				max_key_size = std::max(max_key_size, key.size());
-
-			const std::string tab(level, '\t');
-			dest << "{\n";
-			for(auto iter = data.begin(); iter != data.end();) {
-				const auto &[key, value] = *iter;
-				dest << tab << "\t" << std::setw(max_key_size) << std::left << key
-<< " : "; value->print(dest, level + 1); if(++iter == data.end()) dest <<
-"\n"; else dest << ",\n";
+				case '\b':
+					out.write("\\b", 2);
+					break;
+				case '\f':
+					out.write("\\f", 2);
+					break;
+				case '\n':
+					out.write("\\n", 2);
+					break;
+				case '\r':
+					out.write("\\r", 2);
+					break;
+				case '\t':
+					out.write("\\t", 2);
+					break;
+				default: {
+					const char* hex = "0123456789abcdef";
+					const char	u[] = {'\\', 'u', '0', '0', hex[(*p >> 4) & 15], hex[*p & 15]};
+					out.write(u, sizeof(u));
+				}
 			}
-			dest << tab << "}";
 		}
+		out.write(run, end - run);
+		out.put('"');
+	}
 
-		Array *Array::parse(const std::string &str, size_t begin, size_t end,
-size_t &next) { next = begin; if(str[next] != '[') fault; advance;
-
-			std::unique_ptr<Array> ret(new Array);
-
-			do {
-				while(isspace(str[next]))
-					advance;
-				if(str[next] == ']')
+	// output() と同じ形を再帰せずに書き出す.
+	// 開いている container ごとに次に書く要素の位置を stack に積む.
+	template <class Sink>
+	void serialize(Sink& out, const JSO2& root, style s) {
+		const bool pretty = !(s & style::compact);
+		const bool sorted = s & style::sorted;
+		const bool hex		= s & style::hex_bits;
+		const bool packed = s & style::packed;
+
+		// Object の要素は出力する順に members に並べ, [first, last) を frame が持つ
+		struct frame {
+			const JSO2* node;
+			size_t			first;
+			size_t			next;	 // 次に書く要素
+			size_t			last;
+			size_t			width;	// 揃える key の幅
+		};
+		std::vector<frame>														stack;
+		std::vector<const JSO2::Object::value_type*> members;
+
+		auto indent = [&](size_t level) {
+			if(pretty) out.fill(2 * level, ' ');
+		};
+
+		auto put_number = [&](double x) {
+			char buf[number::max_length];
+			out.write(buf, (hex ? number::format_hex(buf, x) : number::format(buf, x)) - buf);
+		};
+
+		// scalar はそのまま書き, container は開き括弧を書いて stack に積む
+		auto open = [&](const JSO2& node) {
+			switch(node.get_type()) {
+				case type::Object: {
+					const size_t first = members.size();
+					size_t			 width = 0;
+					for(const auto& member : node.as<JSO2::Object>()) {
+						members.push_back(&member);
+						if(pretty) width = std::max(width, quoted_length(member.first));
+					}
+					sort_by_key(members.begin() + first, members.end(), sorted);
+					out.put('{');
+					if(pretty) out.put('\n');
+					stack.push_back({&node, first, first, members.size(), width});
+				} break;
+				case type::Array:
+					if(packed && write_block(out, node)) break;
+					out.put('[');
+					if(pretty) out.put('\n');
+					stack.push_back({&node, 0, 0,
+													 node.packed() ? node.numbers().size()
+																				 : node.as<JSO2::Array>().size(),
+													 0});
 					break;
-				else if(Value *val = Value::parse(str, next, end, next); val) {
-					ret->data.emplace_back(val);
-				} else
-					fault;
-
-				if(str[next] == ',')
-					advance;
-				else if(str[next] == ']')
+				case type::String:
+					write_string(out, node.view());
 					break;
-				else
-					fault;
-
-			} while(true);
-
-			advance;
-
-			return ret.release();
-		}
-
-		Array::~Array() {
-			for(auto &p_val : data) delete p_val;
-		}
-
-		void Array::print(std::ostream &dest, size_t level) const {
-			std::string tab(level, '\t');
-			dest << "[\n";
-			for(auto iter = data.begin(); iter != data.end();) {
-				const Value *p_val = *iter;
-				dest << tab << "\t";
-				p_val->print(dest, level + 1);
-				if(++iter == data.end())
-					dest << "\n";
-				else
-					dest << ",\n";
+				case type::Number:
+					put_number(node.as<JSO2::Number>());
+					break;
+				case type::True:
+					out.write("true", 4);
+					break;
+				case type::False:
+					out.write("false", 5);
+					break;
+				case type::Null:
+					out.write("null", 4);
+					break;
+				default:
+					throw std::logic_error("Error: undefined type!");
 			}
-			dest << tab << "]";
-		}
-
-		True *True::parse(const std::string &str, size_t begin, size_t end,
-size_t &next) { if(end - begin < 4 || str.substr(begin, 4) != "true") {
-next = begin; return nullptr;
+		};
+
+		open(root);
+		while(!stack.empty()) {
+			frame&			 f				 = stack.back();
+			const size_t level		 = stack.size();
+			const bool	 is_object = f.node->get_type() == type::Object;
+			if(f.next == f.last) {
+				if(pretty && f.first != f.last) out.put('\n');
+				indent(level - 1);
+				out.put(is_object ? '}' : ']');
+				if(is_object) members.resize(f.first);
+				stack.pop_back();
+				continue;
 			}
-			next = begin + 4;
-			return new True;
-		}
-
-		void True::print(std::ostream &dest, size_t) const {
-			dest << "true";
-		}
-
-		False *False::parse(const std::string &str, size_t begin, size_t end,
-size_t &next) { if(end - begin < 4 || str.substr(begin, 5) != "false") {
-next = begin; return nullptr;
+			if(f.next != f.first) {
+				out.put(',');
+				if(pretty) out.put('\n');
 			}
-			next = begin + 5;
-			return new False;
+			indent(level);
+			if(is_object) {
+				const auto& [key, val] = *members[f.next++];
+				write_string(out, key);
+				if(pretty) {
+					out.fill(f.width - quoted_length(key), ' ');
+					out.write(" : ", 3);
+				} else
+					out.put(':');
+				open(val);
+			} else if(f.node->packed())
+				put_number(f.node->numbers()[f.next++]);
+			else
+				open(((const JSO2::Array&)*f.node)[f.next++]);
 		}
+	}
 
-		void False::print(std::ostream &dest, size_t) const {
-			dest << "false";
-		}
+	std::string JSO2::dump(style s) const {
+		std::string dest;
+		serialize_to(dest, s);
+		return dest;
+	}
 
-		Null *Null::parse(const std::string &str, size_t begin, size_t end,
-size_t &next) { if(end - begin < 4 || str.substr(begin, 4) != "null") {
-next = begin; return nullptr;
-			}
-			next = begin + 4;
-			return new Null;
-		}
+	void JSO2::serialize_to(std::string& dest, style s) const {
+		string_sink out(dest);
+		serialize(out, *this, s);
+	}
 
-		void Null::print(std::ostream &dest, size_t) const {
-			dest << "null";
-		}
+	size_t JSO2::serialize_to(char* buf, size_t size, style s) const {
+		buffer_sink out(buf, size);
+		serialize(out, *this, s);
+		return out.size();
 	}
-		*/
 }
\ No newline at end of file
@@ -1,14 +1,23 @@
 #pragma once
 
+#include <cstdint>
 #include <iosfwd>
 #include <map>
 #include <memory>
+#include <memory_resource>
+#include <new>
+#include <span>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
+#include "Atom.h"
+#include "FlatMap.h"
+
 namespace JSO2 {
 
-	enum class type {
+	enum class type : uint8_t {
 		Value,
 		String,
 		Number,
@@ -20,16 +29,87 @@ namespace JSO2 {
 		TotalTypes
 	};
 
-	class JSO2 {
-		type									_t;
-		std::shared_ptr<void> _v;
+	class Document;
+
+	// serialize_to / dump の出力形式. | で組み合わせる.
+	// pretty : operator<< と同じく改行, 2 文字の字下げ, key の桁揃えを行う
+	// compact : 空白を一切入れない
+	// sorted : Object の要素を挿入順ではなく key 順に書く
+	// hex_bits : Number を "0x" + 16 桁の bit (number::format_hex) で書く. 読み戻すと完全に一致する
+	// packed : 数だけの Array を "@f64(" + base64 + ")" の block (sax::get_block) で書く. 同じく一致する
+	enum class style : uint8_t { pretty = 0, compact = 1, sorted = 2, hex_bits = 4, packed = 8 };
+	constexpr style operator|(style a, style b) {
+		return style(uint8_t(a) | uint8_t(b));
+	}
+	constexpr bool operator&(style a, style b) { return uint8_t(a) & uint8_t(b); }
 
+	class JSO2 {
 	public:
-		using Object = std::map<std::string, JSO2>;
-		using Array	 = std::vector<JSO2>;
+		// Object は挿入順に要素を並べる FlatMap.
+		// JSO2_SORTED_OBJECT を定義すると key 順の std::pmr::map にする.
+#ifdef JSO2_SORTED_OBJECT
+		using Object = std::pmr::map<std::string, JSO2>;
+#else
+		using Object = FlatMap<JSO2>;
+#endif
+		using Array	 = std::pmr::vector<JSO2>;
+		// 数だけを並べた Array の詰めた表現
+		using Numbers = std::pmr::vector<double>;
 		using String = std::string;
 		using Number = double;
 		using Null	 = nullptr_t;
+
+	private:
+		// local : 値そのものを保持 (Number, True, False, Null, 短い文字列)
+		// heap  : new で確保した領域を所有
+		// arena : Document の arena 上の領域. 解放は Document が一括で行う
+		// borrowed : load_borrowed に渡した入力の中を指す. 誰も所有しない
+		enum class storage : uint8_t { local, heap, arena, borrowed };
+
+		static constexpr size_t local_capacity = 14;
+
+		// Number, 各 pointer, arena 上や入力中の文字列 (先頭 pointer + 長さ),
+		// local_capacity 以下の文字列のいずれかを詰める
+		alignas(8) unsigned char _v[local_capacity];
+		// 下位 4 bit : storage, 上位 4 bit : 短い文字列の長さ, Array では Numbers を持つなら 1
+		uint8_t									 _m;
+		type										 _t;
+
+		friend class Document;
+
+		template <class T>
+		T &field(size_t offset = 0) const {
+			return *std::launder(
+					reinterpret_cast<T *>(const_cast<unsigned char *>(_v) + offset));
+		}
+		template <class T>
+		void store(const T &x, size_t offset = 0) {
+			new(_v + offset) T(x);
+		}
+		storage kind() const { return storage(_m & 15); }
+		size_t	local_size() const { return _m >> 4; }
+		void		set(type t, storage s, size_t local_size = 0) {
+			_t = t;
+			_m = uint8_t(s) | uint8_t(local_size << 4);
+		}
+
+		void release();
+		void reset(type t);
+		void assign(std::string_view str, std::pmr::memory_resource *arena);
+		bool load(const char *&p, const char *end, size_t max_depth,
+							std::pmr::memory_resource *arena, bool borrow, KeyPool *keys = nullptr);
+		void materialize(std::pmr::memory_resource *arena);
+		void unpack();
+
+		template <class T>
+		T &ref() const;
+
+	public:
+		class const_element;
+		class element;
+		// sax の event から木を組み立てる (Builder.h)
+		struct builder;
+
 		type get_type() const;
 
 		static const Object &blank_object();
@@ -37,15 +117,45 @@ namespace JSO2 {
 		static const Null &	 null();
 
 		JSO2();
+		// 複製は heap に取る (borrowed な文字列は同じ入力を指す)
+		JSO2(const JSO2 &);
+		// 移動は領域をそのまま引き継ぐ. container の要素の再配置もこれで行う.
+		// Document の木や borrowed な文字列から移した値は, Document の再 load / 破棄や
+		// 入力の破棄の後には使えない. 切り離すには複製して materialize するか Document::detach を使う
+		JSO2(JSO2 &&) noexcept;
 		JSO2(const Object &);
 		JSO2(const Array &);
 		JSO2(const String &str);
 		JSO2(const Number &x);
 		JSO2(const Null &x);
 		JSO2(std::istream &src);
+		~JSO2();
+
+		static constexpr size_t default_max_depth = 1 << 16;
 
-		bool load(std::istream &src);
+		bool load(std::istream &src, size_t max_depth = default_max_depth);
+		bool load(std::string_view src, size_t max_depth = default_max_depth);
+		bool load(const char *&p, const char *end,
+							size_t max_depth = default_max_depth);
+		bool load_file(const std::string &path,
+									 size_t max_depth = default_max_depth);
+		// エスケープを含まない長い文字列を複製せず src の中を指したまま読む.
+		// src は木とその複製 (borrowed な文字列の複製も src を指す) より長く生きること.
+		bool load_borrowed(std::string_view src, size_t max_depth = default_max_depth);
+		// 以下の木の borrowed な文字列を全て複製し, 入力から切り離す
+		void materialize();
+		// 入力の中を指す文字列か
+		bool borrowed() const { return _t == type::String && kind() == storage::borrowed; }
 
+		// load は数だけを並べた Array を Numbers に詰めて持つ. 詰めた Array は numbers() か
+		// 添字 (element) で読み, const の Array としての参照は std::logic_error.
+		// 変更できる Array の参照, 数以外の要素の代入で通常の Array に戻す.
+		bool packed() const { return _t == type::Array && local_size() == 1; }
+		// 詰めた Array の中身. 詰めていなければ std::logic_error
+		std::span<const double> numbers() const;
+
+		JSO2 &operator=(const JSO2 &);
+		JSO2 &operator=(JSO2 &&) noexcept;
 		JSO2 &operator=(const Object &);
 		JSO2 &operator=(const Array &);
 		JSO2 &operator=(const String &);
@@ -54,30 +164,234 @@ namespace JSO2 {
 		JSO2 &operator=(int);
 		JSO2 &operator=(bool);
 		JSO2 &operator=(const Null &);
+		// 詰めた Array にする
+		JSO2 &operator=(std::span<const double> xs);
+
+		void swap(JSO2 &other) noexcept;
 
+		// const の Object で無い key を引くと std::out_of_range
 		JSO2 &			operator[](const String &key);
 		const JSO2 &operator[](const String &key) const;
 		JSO2 &			operator[](const char *key);
 		const JSO2 &operator[](const char *key) const;
-		JSO2 &			operator[](int index);
-		const JSO2 &operator[](int index) const;
+		// 非 const では Array でなければ詰めた Array にし, 範囲外の index は Array を伸ばす
+		element				operator[](int index);
+		const_element operator[](int index) const;
+		// intern した key で引く. FlatMap では 2 回目から pointer の比較で見つかる
+		JSO2 &			operator[](const Atom &key);
+		const JSO2 &operator[](const Atom &key) const;
 
 		operator const Object &() const;
 		operator Object &();
 		operator const Array &() const;
 		operator Array &();
+		// 短い文字列は最初の参照で heap に移す (同じ node を別の thread から読むなら view() を使う).
+		// const では arena 上や borrowed な文字列は std::logic_error. 非 const はどれも heap に移す
 		operator const String &() const;
 		operator String &();
 		operator const Number &() const;
 		operator Number &();
 		operator bool() const;
 
+		// 文字列をコピーせずに参照する
+		std::string_view view() const;
+
+		// std::ostream を介さずに書き出す. 文字列は JSON の escape を施す.
+		std::string dump(style s = style::pretty) const;
+		void				serialize_to(std::string &dest, style s = style::pretty) const;
+		// 先頭 size byte までを buf に書き, 必要な長さを返す (終端の '\0' は付けない)
+		size_t serialize_to(char *buf, size_t size,
+												style s = style::pretty) const;
+
 		template <class T>
 		const T &as() const {
-			return static_cast<T *>(_v);
+			return ref<T>();
+		}
+	};
+
+	template <>
+	JSO2::Object &JSO2::ref<JSO2::Object>() const;
+	template <>
+	JSO2::Array &JSO2::ref<JSO2::Array>() const;
+	template <>
+	JSO2::String &JSO2::ref<JSO2::String>() const;
+	template <>
+	JSO2::Number &JSO2::ref<JSO2::Number>() const;
+
+	// Array の index 番目の要素. 詰めた Array では Numbers の中の数をそのまま指し,
+	// 数として読み書きする限り展開しない. 詰めた Array の要素を const JSO2 & として
+	// 取り出すと std::logic_error.
+	class JSO2::const_element {
+	protected:
+		JSO2	*_array;
+		size_t _index;
+
+		friend class JSO2;
+		const_element(const JSO2 *array, size_t index)
+				: _array(const_cast<JSO2 *>(array)), _index(index) {}
+		const Number *number() const {
+			return _array->packed() ? &(*_array->field<Numbers *>())[_index] : nullptr;
+		}
+
+	public:
+		const JSO2 &get() const { return _array->ref<Array>()[_index]; }
+		type				get_type() const { return number() ? type::Number : get().get_type(); }
+
+		operator const JSO2 &() const { return get(); }
+		operator const Object &() const { return get(); }
+		operator const Array &() const { return get(); }
+		operator const String &() const { return get(); }
+		operator const Number &() const {
+			if(const Number *x = number()) return *x;
+			return get();
+		}
+		operator bool() const { return get(); }
+
+		const JSO2 *operator->() const { return &get(); }
+
+		bool										borrowed() const { return !number() && get().borrowed(); }
+		bool										packed() const { return !number() && get().packed(); }
+		std::span<const double> numbers() const { return get().numbers(); }
+		std::string_view				view() const { return get().view(); }
+
+		std::string dump(style s = style::pretty) const;
+		void				serialize_to(std::string &dest, style s = style::pretty) const;
+		size_t			serialize_to(char *buf, size_t size, style s = style::pretty) const;
+
+		template <class T>
+		const T &as() const {
+			return *this;
+		}
+
+		const JSO2	 &operator[](const String &key) const { return get()[key]; }
+		const JSO2	 &operator[](const char *key) const { return get()[key]; }
+		const JSO2	 &operator[](const Atom &key) const { return get()[key]; }
+		const_element operator[](int index) const { return get()[index]; }
+	};
+
+	class JSO2::element : public const_element {
+		friend class JSO2;
+		element(JSO2 *array, size_t index) : const_element(array, index) {}
+		void set_number(Number x) {
+			if(_array->packed())
+				(*_array->field<Numbers *>())[_index] = x;
+			else
+				get() = x;
+		}
+
+	public:
+		using const_element::get;
+		// 数以外として取り出すと詰めた Array を展開する
+		JSO2 &get() {
+			_array->unpack();
+			return _array->ref<Array>()[_index];
+		}
+
+		JSO2 *operator->() { return &get(); }
+
+		operator JSO2 &() { return get(); }
+		operator Object &() { return get(); }
+		operator Array &() { return get(); }
+		operator String &() { return get(); }
+		operator Number &() {
+			if(_array->packed()) return (*_array->field<Numbers *>())[_index];
+			return get();
+		}
+
+		// 数を代入する間は詰めたまま, それ以外は展開してから代入する
+		template <class T>
+		element &operator=(T &&x) {
+			using U = std::remove_cvref_t<T>;
+			if constexpr(std::is_arithmetic_v<U> && !std::is_same_v<U, bool>)
+				set_number(Number(x));
+			else if constexpr(std::is_same_v<U, JSO2> || std::is_base_of_v<const_element, U>) {
+				if(x.get_type() == type::Number)
+					set_number((const Number &)x);
+				else if constexpr(std::is_same_v<U, JSO2>)
+					get() = std::forward<T>(x);
+				else
+					get() = (const JSO2 &)x;
+			} else
+				get() = std::forward<T>(x);
+			return *this;
+		}
+		element &operator=(const element &x) { return operator= <const element &>(x); }
+
+		JSO2	 &operator[](const String &key) { return get()[key]; }
+		JSO2	 &operator[](const char *key) { return get()[key]; }
+		JSO2	 &operator[](const Atom &key) { return get()[key]; }
+		element operator[](int index) { return get()[index]; }
+	};
+
+	// Document の木は node, 文字列, container の領域を全て arena から確保し,
+	// Document の破棄または再 load 時に一括で解放する.
+	// FlatMap では load した key を Document の KeyPool で共有する.
+	class Document {
+		std::pmr::monotonic_buffer_resource _arena;
+		KeyPool															_keys;
+		JSO2																_root;
+
+		void reset();
+
+	public:
+		Document();
+		explicit Document(size_t initial_size);
+
+		Document(const Document &)						= delete;
+		Document &operator=(const Document &) = delete;
+
+		bool load(std::istream &src, size_t max_depth = JSO2::default_max_depth);
+		bool load(std::string_view src,
+							size_t					 max_depth = JSO2::default_max_depth);
+		bool load_file(const std::string &path,
+									 size_t							max_depth = JSO2::default_max_depth);
+		// JSO2::load_borrowed と同じく, src は Document より長く生きること
+		bool load_borrowed(std::string_view src,
+											 size_t						max_depth = JSO2::default_max_depth);
+		// borrowed な文字列を arena に複製する
+		void materialize() { _root.materialize(&_arena); }
+
+		JSO2 &			root() { return _root; }
+		const JSO2 &root() const { return _root; }
+		// 木を heap に複製して入力と arena から切り離して返し, Document を空にする
+		JSO2 detach();
+
+		// load した木の key と pointer で比較できる Atom. intern で登録済みの key はその Atom.
+		// それ以外は次の load または Document の破棄まで有効
+		Atom intern(std::string_view key) { return _keys.intern(key); }
+
+		JSO2 &			operator[](const JSO2::String &key) { return _root[key]; }
+		const JSO2 &operator[](const JSO2::String &key) const { return _root[key]; }
+		JSO2 &			operator[](const char *key) { return _root[key]; }
+		const JSO2 &operator[](const char *key) const { return _root[key]; }
+		JSO2::element				operator[](int index) { return _root[index]; }
+		JSO2::const_element operator[](int index) const { return _root[index]; }
+		JSO2 &			operator[](const Atom &key) { return _root[key]; }
+		const JSO2 &operator[](const Atom &key) const { return _root[key]; }
+
+		std::string dump(style s = style::pretty) const { return _root.dump(s); }
+		void				serialize_to(std::string &dest, style s = style::pretty) const {
+			_root.serialize_to(dest, s);
+		}
+		size_t serialize_to(char *buf, size_t size,
+												style s = style::pretty) const {
+			return _root.serialize_to(buf, size, s);
 		}
 	};
 
 	std::ostream &operator<<(std::ostream &dest, const JSO2 &jso2);
+	std::ostream &operator<<(std::ostream &dest, const JSO2::const_element &elem);
+	std::ostream &operator<<(std::ostream &dest, const Document &doc);
+
+	// operator<< で Object の要素を key 順に書く / 挿入順に戻す.
+	// std::boolalpha と同じく stream に残る.
+	std::ostream &sorted_keys(std::ostream &dest);
+	std::ostream &insertion_order(std::ostream &dest);
+	// operator<< で Number を style::hex_bits の形で書く / 10 進に戻す
+	std::ostream &hex_numbers(std::ostream &dest);
+	std::ostream &decimal_numbers(std::ostream &dest);
+	// operator<< で数だけの Array を style::packed の形で書く / 要素ごとに戻す
+	std::ostream &packed_arrays(std::ostream &dest);
+	std::ostream &plain_arrays(std::ostream &dest);
 
-}
\ No newline at end of file
+}
@@ -1,56 +1,63 @@
 #include "JSONParser.h"
 
+#include "MappedFile.h"
+#include "Number.h"
+#include "Sax.h"
+#include "Scan.h"
+
+#include <bit>
 #include <cctype>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <limits>
 #include <memory>
 #include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
 
 namespace JSON {
 #define fault(name)                                     \
 	do {                                                  \
 		std::cerr << "# JSON : parse error in " #name "\n"; \
 		std::cerr << "# >>>>";                              \
-		std::cerr << buffer;                                \
+		std::cerr << std::string_view(first, p - first);    \
 		std::cerr << "<<<<\n";                              \
 		return nullptr;                                     \
 	} while(false)
 
-#define dequeue(name)                 \
-	do {                                \
-		if(type::name == type::String) {  \
-			if(src)                         \
-				buffer.push_back(src.get());  \
-			else {                          \
-				fault(name);                  \
-			}                               \
-		} else {                          \
-			if(src) {                       \
-				if(src.peek() == '#')         \
-					while(src.peek() != '\n') { \
-						if(src)                   \
-							src.get();              \
-						else                      \
-							fault(name);            \
-					}                           \
-				buffer.push_back(src.get());  \
-			} else {                        \
-				fault(name);                  \
-			}                               \
-		}                                 \
-	} while(false)
+	void skip_white_space(const char *&p, const char *end) {
+		p = JSO2::scan::skip_white_space(p, end);
+	}
+
+	char peek(const char *p, const char *end) { return p < end ? *p : '\0'; }
+
+	bool match(const char *&p, const char *end, std::string_view word) {
+		if(size_t(end - p) < word.size() ||
+			 std::memcmp(p, word.data(), word.size()) != 0)
+			return false;
+		p += word.size();
+		return true;
+	}
 
-	bool is_white_space(char c) {
-		switch(c) {
-			case ' ':		// space
-			case '\n':	// linefeed
-			case '\r':	// carriage return
-			case '\t':	// horizontal tab
-				return true;
+	// stream 版は残りを全て読み込んでから buffer 版で解析し,
+	// seek 可能なら解析し終えた位置まで戻す.
+	template <class T>
+	std::shared_ptr<T> parse_stream(std::istream &src) {
+		const auto	start = src.tellg();
+		std::string text{std::istreambuf_iterator<char>(src),
+										 std::istreambuf_iterator<char>()};
+
+		const char *p		= text.data();
+		auto				ret = T::parse(p, text.data() + text.size());
+
+		if(start != std::istream::pos_type(-1)) {
+			src.clear();
+			src.seekg(start + std::streamoff(p - text.data()));
 		}
-		return false;
+		return ret;
 	}
 
 	std::ostream &operator<<(std::ostream &dest, const Value &val) {
@@ -58,96 +65,102 @@ namespace JSON {
 		return dest;
 	}
 
-	bool is_one_nine(char c) { return '1' <= c && c <= '9'; }
+	std::shared_ptr<Value> Value::parse(std::istream &src) {
+		return parse_stream<Value>(src);
+	}
 
-	bool is_digit(char c) { return '0' <= c && c <= '9'; }
+	std::shared_ptr<Value> Value::parse(std::string_view src) {
+		const char *p = src.data();
+		return parse(p, src.data() + src.size());
+	}
 
-	std::shared_ptr<Value> Value::parse(std::istream &src) {
-		buffer.clear();
-		while(is_white_space(src.peek())) dequeue(Value);
-		std::shared_ptr<Value> val;
-		switch(src.peek()) {
-			case '\"':
-				val = String::parse(src);
-				break;
-			case '{':
-				val = Object::parse(src);
-				break;
-			case '[':
-				val = Array::parse(src);
-				break;
-			case 't':
-				val = True::parse(src);
-				break;
-			case 'f':
-				val = False::parse(src);
-				break;
-			case 'n':
-				val = Null::parse(src);
-				break;
-			case '-':
-			default:
-				if(is_digit(src.peek())) val = Number::parse(src);
+	std::shared_ptr<Value> Value::parse(const char *src, size_t size) {
+		return parse(std::string_view(src, size));
+	}
+
+	std::shared_ptr<Value> Value::parse_file(const std::string &path) {
+		try {
+			JSO2::MappedFile file(path);
+			return parse(file.view());
+		} catch(const std::system_error &e) {
+			std::cerr << "# JSON : cannot read " << e.what() << "\n";
+			return nullptr;
 		}
-		if(!val) fault(Value);
+	}
 
-		while(is_white_space(src.peek())) dequeue(Value);
+	// sax::parse の event から Value の木を組み立てる.
+	// 文字列の復号と文法の検査は JSO2::load と共通になる
+	struct builder : JSO2::sax::handler {
+		std::shared_ptr<Value> root;
+		std::vector<Value *>	 stack;	 // 開いている Object / Array
+		std::string						 key;
+
+		void add(std::shared_ptr<Value> val) {
+			if(stack.empty())
+				root = std::move(val);
+			else if(stack.back()->type_id() == type::Array)
+				static_cast<Array &>(*stack.back()).push_back(std::move(val));
+			else {
+				auto [it, inserted] = static_cast<Object &>(*stack.back()).try_emplace(key, val);
+				if(!inserted) {
+					std::cerr << "# warning : key \"" << key << "\" already contained.\n";
+					std::cerr << "# The previous one is ignored.\n";
+					it->second = std::move(val);
+				}
+			}
+		}
+		template <class T>
+		void open() {
+			auto val = std::make_shared<T>();
+			Value *raw = val.get();
+			add(std::move(val));
+			stack.push_back(raw);
+		}
+
+		void on_object_begin() { open<Object>(); }
+		void on_object_end() { stack.pop_back(); }
+		void on_array_begin() { open<Array>(); }
+		void on_array_end() { stack.pop_back(); }
+		void on_key(std::string_view k) { key = k; }
+		void on_string(std::string_view str) { add(std::make_shared<String>(std::string(str))); }
+		void on_number(double x) { add(std::make_shared<Number>(x)); }
+		void on_bool(bool b) {
+			if(b)
+				add(std::make_shared<True>());
+			else
+				add(std::make_shared<False>());
+		}
+		void on_null() { add(std::make_shared<Null>()); }
+	};
 
-		return std::shared_ptr<Value>(val);
+	std::shared_ptr<Value> Value::parse(const char *&p, const char *end) {
+		const char *first = p;
+		builder			b;
+		try {
+			if(!JSO2::sax::parse(p, end, b)) fault(Value);
+		} catch(const std::exception &) { fault(Value); }
+		return b.root;
 	}
 
-	std::string Value::buffer;
+	// '{' または '[' で始まる値を Value::parse で読む
+	template <class T>
+	std::shared_ptr<T> parse_container(const char *&p, const char *end, char open) {
+		if(peek(p, end) != open) return nullptr;
+		return std::static_pointer_cast<T>(Value::parse(p, end));
+	}
 
 	std::shared_ptr<String> String::parse(std::istream &src) {
-		buffer.clear();
-
-		if(src && src.peek() != '"') return nullptr;
-		src.get();
-
-		do {
-			dequeue(String);
-
-			if(buffer.back() == '\"') {
-				buffer.pop_back();
-				return std::make_shared<String>(buffer);
-			} else if(buffer.back() == '\\') {
-				dequeue(String);
-				switch(buffer.back()) {
-#define push(c)      \
-	buffer.pop_back(); \
-	buffer.pop_back(); \
-	buffer.push_back(c);
-					case '"':
-						push('\"');
-						break;
-					case '\\':
-						push('\\');
-						break;
-					case '/':
-						push('/');
-						break;
-					case 'b':
-						push('\b');
-						break;
-					case 'f':
-						push('\f');
-						break;
-					case 'n':
-						push('\n');
-						break;
-					case 'r':
-						push('\r');
-						break;
-					case 't':
-						push('\t');
-						break;
-#undef push
-					default:
-						fault(String);
-						return nullptr;
-				}
-			}
-		} while(1);
+		return parse_stream<String>(src);
+	}
+
+	std::shared_ptr<String> String::parse(const char *&p, const char *end) {
+		const char *first = p;
+
+		if(peek(p, end) != '"') return nullptr;
+		std::string buffer;
+		try {
+			return std::make_shared<String>(std::string(JSO2::sax::get_string(p, end, buffer)));
+		} catch(const std::invalid_argument &) { fault(String); }
 	}
 
 	void String::print(std::ostream &dest, size_t) const {
@@ -155,115 +168,74 @@ namespace JSON {
 	};
 
 	std::shared_ptr<Number> Number::parse(std::istream &src) {
-		buffer.clear();
+		return parse_stream<Number>(src);
+	}
 
-		if(src.peek() == '-') dequeue(Number);
+	std::shared_ptr<Number> Number::parse(const char *&p, const char *end) {
+		const char *first = p;
+		double			x;
 
-		if(src.peek() == '0')
-			dequeue(Number);
-		else if(is_one_nine(src.peek())) {
-			dequeue(Number);
-			while(is_digit(src.peek())) dequeue(Number);
-		} else
+		if(const char *last = JSO2::number::parse(p, end, x))
+			p = last;
+		else
 			fault(Number);
 
-		if(src.peek() == '.') {
-			dequeue(Number);
-			while(is_digit(src.peek())) dequeue(Number);
-		}
-		if(src.peek() == 'e' || src.peek() == 'E') {
-			dequeue(Number);
-			if(src.peek() == '-' || src.peek() == '+') dequeue(Number);
-			if(!is_digit(src.peek()))
-				fault(Number);
-			else
-				while(is_digit(src.peek())) dequeue(Number);
-		}
-		return std::make_shared<Number>(std::stod(buffer));
+		return std::make_shared<Number>(x);
 	}
 
-	void Number::print(std::ostream &dest, size_t) const { dest << val; }
-
-	bool is_hex(char c) {
-		return ('0' <= c && c <= '9') || ('A' <= c && c <= 'F');
+	// hex_numbers が指定されているか置く stream の場所
+	long &hex_flag(std::ostream &dest) {
+		static const int index = std::ios_base::xalloc();
+		return dest.iword(index);
 	}
 
-	int from_hex(char c) { return '0' <= c && c <= '9' ? c - '0' : c - 'A' + 10; }
-	char to_hex(int n) {
-		n &= 15;
-		return n < 10 ? n + '0' : n - 10 + 'A';
+	std::ostream &hex_numbers(std::ostream &dest) {
+		hex_flag(dest) = 1;
+		return dest;
 	}
 
-	double double_from_binary_string(const std::string &str) {
-		uint64_t binary = 0;
-		double	 x;
-
-		if(str.size() < 16) return std::numeric_limits<double>::quiet_NaN();
+	std::ostream &decimal_numbers(std::ostream &dest) {
+		hex_flag(dest) = 0;
+		return dest;
+	}
 
-		for(size_t i = 0; i < 16; ++i) {
-			if(!is_hex(str[i])) return std::numeric_limits<double>::quiet_NaN();
-			binary <<= 4;
-			binary |= (from_hex(str[i]) & 15);
+	// hex_numbers なら bit の 16 進. std::fixed / std::scientific が指定されていなければ
+	// 最短の round-trip 表記
+	void Number::print(std::ostream &dest, size_t) const {
+		if(hex_flag(dest)) {
+			char buf[JSO2::number::hex_length];
+			dest.write(buf, JSO2::number::format_hex(buf, val) - buf);
+			return;
 		}
-		memcpy(&x, &binary, sizeof(double));
-		return x;
+		if(dest.flags() & std::ios::floatfield) {
+			dest << val;
+			return;
+		}
+		char buf[JSO2::number::max_length];
+		dest.write(buf, JSO2::number::format(buf, val) - buf);
 	}
 
-	std::string binary_string_from_double(double x) {
+	double double_from_binary_string(const std::string &str) {
 		uint64_t binary;
+		if(!JSO2::number::parse_hex_bits(str.data(), str.data() + str.size(), binary))
+			return std::numeric_limits<double>::quiet_NaN();
+		return std::bit_cast<double>(binary);
+	}
 
-		std::memcpy(&binary, &x, sizeof(double));
-		char buf[17] = {};
-		for(size_t i = 0; i < 16; ++i) {
-			buf[15 - i] = to_hex(binary);
-			binary >>= 4;
-		}
-		return buf;
+	std::string binary_string_from_double(double x) {
+		char buf[JSO2::number::hex_length];
+		JSO2::number::format_hex(buf, x);
+		return std::string(buf + 2, 16);
 	}
 
 	std::shared_ptr<Object> Object::parse(std::istream &src) {
-		buffer.clear();
-
-		if(src.peek() != '{') fault(Object);
-		dequeue(Object);
-
-		std::shared_ptr<Object> ret(new Object);
-
-		while(1) {
-			while(is_white_space(src.peek())) dequeue(Object);
-			if(src.peek() == '}') {
-				dequeue(Object);
-				return ret;
-			}
-			std::shared_ptr<String> p_key(String::parse(src));
-
-			if(!p_key) fault(Object);
-
-			while(is_white_space(src.peek())) dequeue(Object);
-
-			if(src.peek() != ':') fault(Object);
-			dequeue(Object);
-
-			std::shared_ptr<Value> p_value = Value::parse(src);
-
-			if(!p_value) fault(Object);
-
-			if(ret->contains((std::string)*p_key)) {
-				std::cerr << "# warning : key \"" << (std::string)*p_key
-									<< "\" already contained.\n";
-				std::cerr << "# The previous one is ignored.\n";
-			}
-
-			(*ret)[(std::string)*p_key] = p_value;
-
-			if(src.peek() == '}') {
-				dequeue(Object);
-				return ret;
-			}
+		return parse_stream<Object>(src);
+	}
 
-			if(src.peek() != ',') fault(Object);
-			dequeue(Object);
-		}
+	std::shared_ptr<Object> Object::parse(const char *&p, const char *end) {
+		const char *first = p;
+		if(auto ret = parse_container<Object>(p, end, '{')) return ret;
+		fault(Object);
 	}
 
 	void Object::print(std::ostream &dest, size_t level) const {
@@ -291,35 +263,13 @@ namespace JSON {
 	}
 
 	std::shared_ptr<Array> Array::parse(std::istream &src) {
-		buffer.clear();
-
-		if(src.peek() != '[') fault(Array);
-		dequeue(Array);
-
-		while(is_white_space(src.peek())) dequeue(Array);
-
-		std::shared_ptr<Array> ret(new Array);
-
-		while(1) {
-			if(src.peek() == ']') {
-				dequeue(Array);
-				return ret;
-			}
-
-			std::shared_ptr<Value> p_value = Value::parse(src);
-
-			if(!p_value) fault(Array);
-
-			ret->push_back(p_value);
-
-			if(src.peek() == ']') {
-				dequeue(Array);
-				return ret;
-			}
+		return parse_stream<Array>(src);
+	}
 
-			if(src.peek() != ',') fault(Object);
-			dequeue(Array);
-		}
+	std::shared_ptr<Array> Array::parse(const char *&p, const char *end) {
+		const char *first = p;
+		if(auto ret = parse_container<Array>(p, end, '[')) return ret;
+		fault(Array);
 	}
 
 	void Array::print(std::ostream &dest, size_t level) const {
@@ -340,41 +290,44 @@ namespace JSON {
 	}
 
 	std::shared_ptr<True> True::parse(std::istream &src) {
-		buffer.clear();
-		for(size_t i = 0; i < 4; ++i) {
-			dequeue(True);
-			if(buffer.back() != "true"[i]) fault(True);
-		}
+		return parse_stream<True>(src);
+	}
+
+	std::shared_ptr<True> True::parse(const char *&p, const char *end) {
+		const char *first = p;
+		if(!match(p, end, "true")) fault(True);
 		return std::make_shared<True>();
 	}
 
 	void True::print(std::ostream &dest, size_t) const { dest << "true"; }
 
 	std::shared_ptr<False> False::parse(std::istream &src) {
-		buffer.clear();
-		for(size_t i = 0; i < 5; ++i) {
-			dequeue(False);
-			if(buffer.back() != "false"[i]) fault(False);
-		}
+		return parse_stream<False>(src);
+	}
+
+	std::shared_ptr<False> False::parse(const char *&p, const char *end) {
+		const char *first = p;
+		if(!match(p, end, "false")) fault(False);
 		return std::make_shared<False>();
 	}
 
 	void False::print(std::ostream &dest, size_t) const { dest << "false"; }
 
 	std::shared_ptr<Null> Null::parse(std::istream &src) {
-		buffer.clear();
-		for(size_t i = 0; i < 4; ++i) {
-			dequeue(True);
-			if(buffer.back() != "null"[i]) fault(True);
-		}
+		return parse_stream<Null>(src);
+	}
+
+	std::shared_ptr<Null> Null::parse(const char *&p, const char *end) {
+		const char *first = p;
+		if(!match(p, end, "null")) fault(Null);
 		return std::make_shared<Null>();
 	}
 
 	void Null::print(std::ostream &dest, size_t) const { dest << "null"; }
 
-#undef pop
 #undef fault
 
+
 	/*
 	namespace v1 {
 
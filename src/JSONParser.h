@@ -5,6 +5,8 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace JSON {
@@ -22,7 +24,12 @@ namespace JSON {
 	};
 
 	struct Value {
+		// parse は共有の状態を持たないので, 別々の thread から同時に呼んでよい
 		static std::shared_ptr<Value> parse(std::istream &src);
+		static std::shared_ptr<Value> parse(std::string_view src);
+		static std::shared_ptr<Value> parse(const char *src, size_t size);
+		static std::shared_ptr<Value> parse(const char *&p, const char *end);
+		static std::shared_ptr<Value> parse_file(const std::string &path);
 
 		virtual ~Value(){};
 		virtual type type_id() const																	 = 0;
@@ -33,26 +40,28 @@ namespace JSON {
 			assert(p);
 			return *p;
 		}
-
-	protected:
-		static std::string buffer;
 	};
 
 	std::ostream &operator<<(std::ostream &dest, const Value &val);
+	// operator<< で Number を IEEE 754 の bit の 16 進 ("0x" と 16 桁) で書く / 10 進に戻す.
+	// std::boolalpha と同じく stream に残る. 書いた形は Value::parse で読める.
+	std::ostream &hex_numbers(std::ostream &dest);
+	std::ostream &decimal_numbers(std::ostream &dest);
 
 	struct String : Value, std::string {
 		static std::shared_ptr<String> parse(std::istream &src);
+		static std::shared_ptr<String> parse(const char *&p, const char *end);
 
 		String() : std::string() {}
 		String(const std::string &str) : std::string(str) {}
-		String(std::string &&str) : std::string(str) {}
+		String(std::string &&str) : std::string(std::move(str)) {}
 
 		String &operator=(const std::string &str) {
 			std::string::operator=(str);
 			return *this;
 		}
 		String &operator=(std::string &&str) {
-			std::string::operator=(str);
+			std::string::operator=(std::move(str));
 			return *this;
 		}
 
@@ -64,6 +73,7 @@ namespace JSON {
 
 	struct Number : Value {
 		static std::shared_ptr<Number> parse(std::istream &src);
+		static std::shared_ptr<Number> parse(const char *&p, const char *end);
 
 		virtual ~Number(){};
 		type type_id() const { return type::Number; }
@@ -83,6 +93,7 @@ namespace JSON {
 
 	struct Object : Value, std::map<std::string, std::shared_ptr<Value>> {
 		static std::shared_ptr<Object> parse(std::istream &src);
+		static std::shared_ptr<Object> parse(const char *&p, const char *end);
 
 		type type_id() const { return type::Object; }
 		void print(std::ostream &dest, size_t level = 0) const;
@@ -90,6 +101,7 @@ namespace JSON {
 
 	struct Array : Value, std::vector<std::shared_ptr<Value>> {
 		static std::shared_ptr<Array> parse(std::istream &src);
+		static std::shared_ptr<Array> parse(const char *&p, const char *end);
 
 		type type_id() const { return type::Array; }
 		void print(std::ostream &dest, size_t level) const;
@@ -97,6 +109,7 @@ namespace JSON {
 
 	struct True : Value {
 		static std::shared_ptr<True> parse(std::istream &src);
+		static std::shared_ptr<True> parse(const char *&p, const char *end);
 
 		~True(){};
 		type type_id() const { return type::True; };
@@ -105,6 +118,7 @@ namespace JSON {
 
 	struct False : Value {
 		static std::shared_ptr<False> parse(std::istream &src);
+		static std::shared_ptr<False> parse(const char *&p, const char *end);
 
 		~False(){};
 		type type_id() const { return type::False; };
@@ -113,6 +127,7 @@ namespace JSON {
 
 	struct Null : Value {
 		static std::shared_ptr<Null> parse(std::istream &src);
+		static std::shared_ptr<Null> parse(const char *&p, const char *end);
 
 		~Null(){};
 		type type_id() const { return type::Null; };
@@ -0,0 +1,209 @@
+#include "LazyDocument.h"
+
+#include "Sax.h"
+#include "Scan.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+
+namespace JSO2 {
+
+	namespace {
+
+		template <class Members>
+		auto find(const Members &members, std::string_view key) {
+			auto it = std::lower_bound(
+					members.begin(), members.end(), key,
+					[](const auto &member, std::string_view k) { return member.first < k; });
+			return it != members.end() && it->first == key ? it : members.end();
+		}
+
+	}
+
+	LazyDocument::LazyDocument() {}
+	LazyDocument::~LazyDocument() {}
+
+	bool LazyDocument::load(std::string_view src) {
+		if(src.size() > std::numeric_limits<uint32_t>::max())
+			throw std::length_error("JSO2 : LazyDocument is limited to 4 GiB\n");
+		_children.clear();
+		_values.clear();
+		_src		= src;
+		_index	= scan::index(src.data(), src.data() + src.size());
+		_match.assign(_index.size(), 0);
+
+		// 括弧の対応を求める
+		std::vector<uint32_t> stack;
+		for(uint32_t k = 0; k < _index.size(); ++k) {
+			const char c = src[_index[k]];
+			if(c == '{' || c == '[')
+				stack.push_back(k);
+			else if(c == '}' || c == ']') {
+				if(stack.empty() || src[_index[stack.back()]] != (c == '}' ? '{' : '['))
+					throw std::invalid_argument(c == '}' ? "Invalid sequence for Object\n"
+																							 : "Invalid sequence for Array\n");
+				_match[stack.back()] = k;
+				stack.pop_back();
+			}
+		}
+		if(!stack.empty())
+			throw std::invalid_argument(src[_index[stack.back()]] == '{'
+																			? "Invalid sequence for Object\n"
+																			: "Invalid sequence for Array\n");
+
+		const char *p = scan::skip_white_space(src.data(), src.data() + src.size());
+		_root					= p - src.data();
+		return p != src.data() + src.size();
+	}
+
+	bool LazyDocument::load_file(const std::string &path) {
+		_file = std::make_unique<MappedFile>(path);
+		return load(_file->view());
+	}
+
+	// container の直下の値の先頭位置を区切り文字から求める.
+	// scalar は index に現れないので ',' / ':' の直後から空白を飛ばして探す.
+	const LazyDocument::Children &LazyDocument::children(uint32_t offset) const {
+		// block は index に現れないので子の位置を持たない
+		if(_src[offset] == '@')
+			throw std::logic_error("JSO2 : elements of a packed array are read through value()\n");
+		const size_t k = std::lower_bound(_index.begin(), _index.end(), offset) -
+										 _index.begin();
+		if(auto it = _children.find(k); it != _children.end()) return it->second;
+
+		const bool	is_object = _src[offset] == '{';
+		const char *message		= is_object ? "Invalid sequence for Object\n"
+																			: "Invalid sequence for Array\n";
+		const char *base			= _src.data();
+		const char *end				= base + _src.size();
+		const size_t m				= _match[k];
+		Children		 c;
+		std::string	 buffer;
+
+		uint32_t prev = offset;
+		size_t	 j		= k + 1;
+		while(1) {
+			const char *v = scan::skip_white_space(base + prev + 1, end);
+			// 空の container と末尾の ',' (JSO2::load と同じく許す)
+			if(uint32_t(v - base) == _index[m]) break;
+
+			std::string_view key;
+			if(is_object) {
+				if(j >= m || _index[j] != uint32_t(v - base) || *v != '"')
+					throw std::invalid_argument(message);
+				const char *q = v;
+				key						= sax::get_string(q, end, buffer);
+				if(key.data() == buffer.data()) key = c.keys.emplace_front(buffer);
+				if(++j >= m || base[_index[j]] != ':') throw std::invalid_argument(message);
+				prev = _index[j++];
+				v		 = scan::skip_white_space(base + prev + 1, end);
+			}
+
+			const uint32_t value = v - base;
+			if(j < m && _index[j] == value) {
+				if(*v == '{' || *v == '[')
+					j = _match[j] + 1;
+				else if(*v == '"')
+					++j;
+				else
+					throw std::invalid_argument(message);
+			} else if(v == end)
+				throw std::invalid_argument(message);
+
+			if(is_object)
+				c.members.emplace_back(key, value);
+			else
+				c.elements.push_back(value);
+
+			if(j == m) break;
+			if(base[_index[j]] != ',') throw std::invalid_argument(message);
+			prev = _index[j++];
+		}
+
+		// 重複した key は JSO2::load と同じく後のものだけを残す
+		auto &members = c.members;
+		std::stable_sort(members.begin(), members.end(),
+										 [](const auto &a, const auto &b) { return a.first < b.first; });
+		auto last = members.begin();
+		for(auto it = members.begin(); it != members.end(); ++it) {
+			if(it + 1 != members.end() && it[1].first == it->first) continue;
+			*last++ = *it;
+		}
+		members.erase(last, members.end());
+		return _children.emplace(k, std::move(c)).first->second;
+	}
+
+	type LazyDocument::Node::get_type() const {
+		const char *p = _doc->_src.data() + _offset;
+		return sax::detect_type(p, _doc->_src.data() + _doc->_src.size());
+	}
+
+	LazyDocument::Node LazyDocument::Node::operator[](std::string_view key) const {
+		assert(get_type() == type::Object);
+		const auto &members = _doc->children(_offset).members;
+		auto				it			= find(members, key);
+		if(it == members.end()) throw std::out_of_range("JSO2 : no such key\n");
+		return Node(_doc, it->second);
+	}
+
+	LazyDocument::Node LazyDocument::Node::operator[](int index) const {
+		assert(get_type() == type::Array);
+		const auto &elements = _doc->children(_offset).elements;
+		if(index < 0 || size_t(index) >= elements.size())
+			throw std::out_of_range("JSO2 : index out of range\n");
+		return Node(_doc, elements[index]);
+	}
+
+	bool LazyDocument::Node::contains(std::string_view key) const {
+		assert(get_type() == type::Object);
+		const auto &members = _doc->children(_offset).members;
+		return find(members, key) != members.end();
+	}
+
+	size_t LazyDocument::Node::size() const {
+		const type t = get_type();
+		assert(t == type::Object || t == type::Array);
+		if(_doc->_src[_offset] == '@') return value().numbers().size();
+		const auto &c = _doc->children(_offset);
+		return t == type::Object ? c.members.size() : c.elements.size();
+	}
+
+	double LazyDocument::Node::number() const {
+		assert(get_type() == type::Number);
+		const char *p = _doc->_src.data() + _offset;
+		return sax::get_number(p, _doc->_src.data() + _doc->_src.size());
+	}
+
+	bool LazyDocument::Node::boolean() const {
+		assert(get_type() == type::True || get_type() == type::False);
+		return get_type() == type::True;
+	}
+
+	// エスケープを含まなければ入力を直接指す
+	std::string_view LazyDocument::Node::view() const {
+		assert(get_type() == type::String);
+		const char			*p = _doc->_src.data() + _offset;
+		std::string			 buffer;
+		std::string_view str =
+				sax::get_string(p, _doc->_src.data() + _doc->_src.size(), buffer);
+		if(str.data() != buffer.data()) return str;
+		return value().view();
+	}
+
+	const JSO2 &LazyDocument::Node::value() const {
+		auto [it, inserted] = _doc->_values.try_emplace(_offset);
+		if(inserted) {
+			try {
+				const char *p = _doc->_src.data() + _offset;
+				it->second.load(p, _doc->_src.data() + _doc->_src.size());
+			} catch(...) {
+				_doc->_values.erase(it);
+				throw;
+			}
+		}
+		return it->second;
+	}
+
+}
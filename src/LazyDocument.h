@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <forward_list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "JSO2.h"
+#include "MappedFile.h"
+
+namespace JSO2 {
+
+	// load では構造文字の位置 (scan::index) と括弧の対応だけを求め,
+	// 値は operator[] で辿られた所だけを読んで結果を保持する.
+	// 辿らなかった部分は確保も文法の検査もしない.
+	// load(std::string_view) に渡した領域は LazyDocument より長く生きること.
+	// 内部の cache を更新するので, 複数の thread から同時に使ってはならない.
+	class LazyDocument {
+	public:
+		class Node {
+			const LazyDocument *_doc;
+			uint32_t						_offset;	// 値の先頭の位置
+
+			friend class LazyDocument;
+			Node(const LazyDocument *doc, uint32_t offset)
+					: _doc(doc), _offset(offset) {}
+
+		public:
+			type get_type() const;
+
+			// 無い key と範囲外の index は std::out_of_range を投げる.
+			// block (sax::get_block) の要素は value() から読む (operator[] は std::logic_error)
+			Node operator[](std::string_view key) const;
+			Node operator[](const char *key) const {
+				return operator[](std::string_view(key));
+			}
+			Node operator[](int index) const;
+			bool contains(std::string_view key) const;
+			size_t size() const;
+
+			double					 number() const;
+			bool						 boolean() const;
+			std::string_view view() const;
+			// この値以下の木を JSO2 として読む
+			const JSO2 &value() const;
+		};
+
+	private:
+		// 辿った container の子の位置
+		struct Children {
+			std::vector<std::pair<std::string_view, uint32_t>> members;	 // key 順
+			std::vector<uint32_t>															 elements;
+			std::forward_list<std::string> keys;	 // エスケープを復号した key
+		};
+
+		std::unique_ptr<MappedFile> _file;
+		std::string_view						_src;
+		std::vector<uint32_t>				_index;
+		std::vector<uint32_t>				_match;	 // 開き括弧に対応する閉じ括弧の index 上の位置
+		uint32_t										_root = 0;
+
+		mutable std::unordered_map<uint32_t, Children> _children;
+		mutable std::unordered_map<uint32_t, JSO2>		 _values;
+
+		const Children &children(uint32_t offset) const;
+
+	public:
+		LazyDocument();
+		~LazyDocument();
+
+		LazyDocument(const LazyDocument &)						= delete;
+		LazyDocument &operator=(const LazyDocument &) = delete;
+
+		// 空の入力なら false. 括弧の対応が取れなければ std::invalid_argument.
+		// 4 GiB を超える入力は std::length_error.
+		bool load(std::string_view src);
+		bool load_file(const std::string &path);
+
+		Node root() const { return Node(this, _root); }
+		Node operator[](std::string_view key) const { return root()[key]; }
+		Node operator[](const char *key) const { return root()[key]; }
+		Node operator[](int index) const { return root()[index]; }
+	};
+
+}
@@ -0,0 +1,306 @@
+#include "MappedDocument.h"
+
+#include "Builder.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+namespace JSO2 {
+
+	static_assert(std::endian::native == std::endian::little,
+								"MappedDocument reads its fields in host byte order");
+
+	namespace {
+
+		constexpr size_t slot_size	= 16;
+		constexpr size_t entry_size = 16 + slot_size;
+
+		const char *const message = "Invalid sequence for MappedDocument\n";
+
+		template <class T>
+		T read(const char *p) {
+			T x;
+			std::memcpy(&x, p, sizeof(T));
+			return x;
+		}
+
+		template <class T>
+		void write_at(std::string &dest, size_t offset, const T &x) {
+			std::memcpy(dest.data() + offset, &x, sizeof(T));
+		}
+
+		void put_slot(std::string &dest, size_t at, uint64_t payload, uint32_t size,
+									type t) {
+			write_at(dest, at, payload);
+			write_at(dest, at + 8, size);
+			dest[at + 12] = char(t);
+		}
+
+	}
+
+	MappedDocument::MappedDocument() {}
+	MappedDocument::~MappedDocument() {}
+
+	void MappedDocument::write(std::string &dest, const JSO2 &src) {
+		dest.assign(magic);
+		dest.append(slot_size, '\0');
+
+		// 中身を書く値と, その slot の位置
+		std::vector<std::pair<const JSO2 *, size_t>> pending = {{&src, magic.size()}};
+		auto block = [&](size_t n, size_t width) {
+			dest.resize((dest.size() + 7) & ~size_t(7), '\0');
+			const size_t offset = dest.size();
+			dest.append(8 + n * width, '\0');
+			write_at(dest, offset, uint64_t(n));
+			return offset;
+		};
+
+		while(!pending.empty()) {
+			const auto [node, at] = pending.back();
+			pending.pop_back();
+			const type t = node->get_type();
+			switch(t) {
+				case type::Number:
+					put_slot(dest, at, std::bit_cast<uint64_t>((const JSO2::Number &)*node), 0, t);
+					break;
+				case type::True:
+				case type::False:
+				case type::Null:
+					put_slot(dest, at, 0, 0, t);
+					break;
+				case type::String: {
+					const std::string_view str = node->view();
+					if(str.size() > std::numeric_limits<uint32_t>::max())
+						throw std::length_error("JSO2 : MappedDocument strings are limited to 4 GiB\n");
+					put_slot(dest, at, dest.size(), str.size(), t);
+					dest.append(str);
+				} break;
+				case type::Array: {
+					if(node->packed()) {
+						const auto	 xs			= node->numbers();
+						const size_t offset = block(xs.size(), slot_size);
+						put_slot(dest, at, offset, 0, t);
+						for(size_t i = 0; i < xs.size(); ++i)
+							put_slot(dest, offset + 8 + i * slot_size, std::bit_cast<uint64_t>(xs[i]), 0,
+											 type::Number);
+						break;
+					}
+					const auto	&arr		= (const JSO2::Array &)*node;
+					const size_t offset = block(arr.size(), slot_size);
+					put_slot(dest, at, offset, 0, t);
+					// 先頭の要素から順に配置されるよう逆順に積む
+					for(size_t i = arr.size(); i-- > 0;)
+						pending.emplace_back(&arr[i], offset + 8 + i * slot_size);
+				} break;
+				case type::Object: {
+					std::vector<const JSO2::Object::value_type *> members;
+					for(const auto &member : (const JSO2::Object &)*node)
+						members.push_back(&member);
+					std::sort(members.begin(), members.end(),
+										[](const auto *a, const auto *b) { return a->first < b->first; });
+					const size_t offset = block(members.size(), entry_size);
+					put_slot(dest, at, offset, 0, t);
+					for(size_t i = 0; i < members.size(); ++i) {
+						const std::string_view key	 = members[i]->first;
+						const size_t			 entry = offset + 8 + i * entry_size;
+						if(key.size() > std::numeric_limits<uint32_t>::max())
+							throw std::length_error("JSO2 : MappedDocument strings are limited to 4 GiB\n");
+						write_at(dest, entry, uint64_t(dest.size()));
+						write_at(dest, entry + 8, uint32_t(key.size()));
+						dest.append(key);
+					}
+					for(size_t i = members.size(); i-- > 0;)
+						pending.emplace_back(&members[i]->second,
+																 offset + 8 + i * entry_size + 16);
+				} break;
+				default:
+					throw std::logic_error("Error: undefined type!");
+			}
+		}
+	}
+
+	void MappedDocument::write_file(const std::string &path, const JSO2 &src) {
+		std::string image;
+		write(image, src);
+		std::ofstream out(path, std::ios::binary);
+		out.write(image.data(), image.size());
+		if(!out) throw std::system_error(errno, std::generic_category(), path);
+	}
+
+	bool MappedDocument::open(std::string_view src) {
+		if(src.empty()) return false;
+		if(src.size() < magic.size() + slot_size || src.substr(0, magic.size()) != magic)
+			throw std::invalid_argument(message);
+		_src = src;
+		return true;
+	}
+
+	bool MappedDocument::open_file(const std::string &path) {
+		_file = std::make_unique<MappedFile>(path);
+		return open(_file->view());
+	}
+
+	const char *MappedDocument::range(uint64_t offset, uint64_t size) const {
+		if(offset > _src.size() || size > _src.size() - offset)
+			throw std::invalid_argument(message);
+		return _src.data() + offset;
+	}
+
+	type MappedDocument::Node::get_type() const {
+		const uint8_t t = uint8_t(_doc->range(_slot + 12, 1)[0]);
+		if(t == uint8_t(type::Value) || t >= uint8_t(type::TotalTypes))
+			throw std::invalid_argument(message);
+		return type(t);
+	}
+
+	uint64_t MappedDocument::Node::payload() const {
+		return read<uint64_t>(_doc->range(_slot, 8));
+	}
+
+	// container の要素数. 要素の並びが範囲内にあることも確かめる
+	size_t MappedDocument::Node::count(size_t width) const {
+		const uint64_t offset = payload();
+		const uint64_t n			= read<uint64_t>(_doc->range(offset, 8));
+		if(n > (_doc->_src.size() - offset - 8) / width) throw std::invalid_argument(message);
+		return n;
+	}
+
+	std::string_view MappedDocument::Node::key(size_t index) const {
+		assert(get_type() == type::Object);
+		if(index >= count(entry_size)) throw std::out_of_range("JSO2 : index out of range\n");
+		const char *entry = _doc->_src.data() + payload() + 8 + index * entry_size;
+		const uint64_t offset = read<uint64_t>(entry);
+		const uint32_t size		= read<uint32_t>(entry + 8);
+		return {_doc->range(offset, size), size};
+	}
+
+	MappedDocument::Node MappedDocument::Node::member(size_t index) const {
+		assert(get_type() == type::Object);
+		if(index >= count(entry_size)) throw std::out_of_range("JSO2 : index out of range\n");
+		return Node(_doc, payload() + 8 + index * entry_size + 16);
+	}
+
+	// key の位置. 無ければ size()
+	size_t MappedDocument::Node::find(std::string_view key) const {
+		assert(get_type() == type::Object);
+		const size_t n = count(entry_size);
+		size_t			 lo = 0, hi = n;
+		while(lo < hi) {
+			const size_t mid = (lo + hi) / 2;
+			if(this->key(mid) < key)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo < n && this->key(lo) == key ? lo : n;
+	}
+
+	MappedDocument::Node MappedDocument::Node::operator[](std::string_view key) const {
+		const size_t i = find(key);
+		if(i == size()) throw std::out_of_range("JSO2 : no such key\n");
+		return member(i);
+	}
+
+	MappedDocument::Node MappedDocument::Node::operator[](int index) const {
+		assert(get_type() == type::Array);
+		if(index < 0 || size_t(index) >= count(slot_size))
+			throw std::out_of_range("JSO2 : index out of range\n");
+		return Node(_doc, payload() + 8 + index * slot_size);
+	}
+
+	bool MappedDocument::Node::contains(std::string_view key) const {
+		return find(key) != size();
+	}
+
+	size_t MappedDocument::Node::size() const {
+		const type t = get_type();
+		assert(t == type::Object || t == type::Array);
+		return count(t == type::Object ? entry_size : slot_size);
+	}
+
+	double MappedDocument::Node::number() const {
+		assert(get_type() == type::Number);
+		return std::bit_cast<double>(payload());
+	}
+
+	bool MappedDocument::Node::boolean() const {
+		assert(get_type() == type::True || get_type() == type::False);
+		return get_type() == type::True;
+	}
+
+	std::string_view MappedDocument::Node::view() const {
+		assert(get_type() == type::String);
+		const uint32_t size = read<uint32_t>(_doc->range(_slot + 8, 4));
+		return {_doc->range(payload(), size), size};
+	}
+
+	// JSO2::load と同じ builder に値を順に渡し, 数だけの Array は同じく詰める
+	JSO2 MappedDocument::Node::value() const {
+		struct frame {
+			Node	 node;
+			bool	 object;
+			size_t next;
+			size_t size;
+		};
+		std::vector<frame> stack;
+		JSO2::builder			 b;
+
+		auto put = [&](const Node &node) {
+			switch(node.get_type()) {
+				case type::Number:
+					b.on_number(node.number());
+					break;
+				case type::True:
+				case type::False:
+					b.on_bool(node.boolean());
+					break;
+				case type::Null:
+					b.on_null();
+					break;
+				case type::String:
+					b.on_string(node.view());
+					break;
+				case type::Array:
+					b.on_array_begin();
+					stack.push_back({node, false, 0, node.size()});
+					break;
+				case type::Object:
+					b.on_object_begin();
+					stack.push_back({node, true, 0, node.size()});
+					break;
+				default:
+					break;
+			}
+		};
+
+		put(*this);
+		while(!stack.empty()) {
+			frame &f = stack.back();
+			if(f.next == f.size) {
+				if(f.object)
+					b.on_object_end();
+				else
+					b.on_array_end();
+				stack.pop_back();
+				continue;
+			}
+			const Node	 node = f.node;
+			const size_t i		= f.next++;
+			if(f.object) {
+				b.on_key(node.key(i));
+				put(node.member(i));
+			} else
+				put(node[int(i)]);
+		}
+		return std::move(b.root);
+	}
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "JSO2.h"
+#include "MappedFile.h"
+
+namespace JSO2 {
+
+	// 読むだけの大きな表を起動のたびに解析し直さずに済ませるための形式.
+	// write で JSO2 の木を offset で辿れる配置に書き出し, open はその先頭を
+	// 確かめるだけで終わる. 値は Node で辿った所をその場で読む.
+	//
+	// 配置 (little endian, 全ての block は 8 byte 境界)
+	//   header : magic "JSO2MAP" + '\0', root の slot
+	//   slot   : payload 8 byte, size 4 byte, type 1 byte, 予備 3 byte
+	//            Number は payload に bit をそのまま, 文字列は payload に先頭の offset と
+	//            size に長さ, Array / Object は payload に block の offset
+	//   Array  : 要素数 8 byte + slot の並び
+	//   Object : 要素数 8 byte + (key の offset 8 byte, 長さ 4 byte, 予備 4 byte, slot) を
+	//            key の byte 順に並べたもの
+	class MappedDocument {
+	public:
+		class Node {
+			const MappedDocument *_doc;
+			uint64_t							_slot;	// slot の offset
+
+			friend class MappedDocument;
+			Node(const MappedDocument *doc, uint64_t slot) : _doc(doc), _slot(slot) {}
+			uint64_t payload() const;
+			size_t	 count(size_t width) const;
+			size_t	 find(std::string_view key) const;
+
+		public:
+			type get_type() const;
+
+			// 無い key と範囲外の index は std::out_of_range を投げる.
+			// key は二分探索で引く.
+			Node operator[](std::string_view key) const;
+			Node operator[](const char *key) const {
+				return operator[](std::string_view(key));
+			}
+			Node operator[](int index) const;
+			bool contains(std::string_view key) const;
+			size_t size() const;
+
+			// Object の index 番目 (key の順) の要素
+			std::string_view key(size_t index) const;
+			Node						 member(size_t index) const;
+
+			double					 number() const;
+			bool						 boolean() const;
+			std::string_view view() const;
+			// この値以下を JSO2 の木に複製する
+			JSO2 value() const;
+		};
+
+	private:
+		std::unique_ptr<MappedFile> _file;
+		std::string_view						_src;
+
+		// [offset, offset + size) の先頭. 入力の外なら std::invalid_argument
+		const char *range(uint64_t offset, uint64_t size) const;
+
+	public:
+		static constexpr std::string_view magic = std::string_view("JSO2MAP\0", 8);
+
+		MappedDocument();
+		~MappedDocument();
+
+		MappedDocument(const MappedDocument &)						= delete;
+		MappedDocument &operator=(const MappedDocument &) = delete;
+
+		// dest の内容を置き換える. 型の無い値 (type::Value) は std::logic_error,
+		// 4 GiB 以上の文字列は std::length_error.
+		static void write(std::string &dest, const JSO2 &src);
+		static void write_file(const std::string &path, const JSO2 &src);
+
+		// 空の入力なら false, magic が合わなければ std::invalid_argument.
+		// 中身は辿った時に確かめ, 入力の外を指す offset や不明な type は
+		// std::invalid_argument を投げる (offset の循環は検出しない).
+		// open(std::string_view) に渡した領域は MappedDocument より長く生きること.
+		bool open(std::string_view src);
+		bool open_file(const std::string &path);
+
+		Node root() const { return Node(this, magic.size()); }
+		Node operator[](std::string_view key) const { return root()[key]; }
+		Node operator[](const char *key) const { return root()[key]; }
+		Node operator[](int index) const { return root()[index]; }
+	};
+
+}
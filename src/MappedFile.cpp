@@ -0,0 +1,52 @@
+#include "MappedFile.h"
+
+#include <cerrno>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace JSO2 {
+
+	MappedFile::MappedFile(const std::string &path)
+			: _data(nullptr), _size(0), _mapped(false) {
+		int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if(fd < 0) throw std::system_error(errno, std::generic_category(), path);
+
+		struct stat st;
+		if(::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+			void *p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(p != MAP_FAILED) {
+				::madvise(p, st.st_size, MADV_SEQUENTIAL);
+				_data		= static_cast<const char *>(p);
+				_size		= st.st_size;
+				_mapped = true;
+				::close(fd);
+				return;
+			}
+		}
+
+		char buf[1 << 16];
+		while(1) {
+			ssize_t n = ::read(fd, buf, sizeof(buf));
+			if(n == 0) break;
+			if(n < 0) {
+				if(errno == EINTR) continue;
+				int err = errno;
+				::close(fd);
+				throw std::system_error(err, std::generic_category(), path);
+			}
+			_buffer.append(buf, n);
+		}
+		::close(fd);
+		_data = _buffer.data();
+		_size = _buffer.size();
+	}
+
+	MappedFile::~MappedFile() {
+		if(_mapped) ::munmap(const_cast<char *>(_data), _size);
+	}
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace JSO2 {
+
+	// 読み取り専用でファイルを mmap する. 通常ファイル以外 (pipe 等) は
+	// read() で全体を読み込む.
+	class MappedFile {
+		const char *_data;
+		size_t			_size;
+		bool				_mapped;
+		std::string _buffer;
+
+	public:
+		explicit MappedFile(const std::string &path);
+		~MappedFile();
+
+		MappedFile(const MappedFile &)						= delete;
+		MappedFile &operator=(const MappedFile &) = delete;
+
+		const char *		 data() const { return _data; }
+		size_t					 size() const { return _size; }
+		bool						 mapped() const { return _mapped; }
+		std::string_view view() const { return {_data, _size}; }
+	};
+
+}
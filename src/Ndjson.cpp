@@ -0,0 +1,150 @@
+#include "Ndjson.h"
+
+#include "MappedFile.h"
+#include "Scan.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace JSO2::ndjson {
+
+	namespace {
+
+		// thread 間で取り合う単位. 短い行が多いので数行ずつまとめる
+		constexpr size_t batch = 16;
+
+		const char *find(const char *p, const char *end, char c) {
+			const char *q = (const char *)std::memchr(p, c, end - p);
+			return q ? q : end;
+		}
+
+		// 1 行を読む. 値の後ろに空白とコメント以外が残っていれば文法違反.
+		JSO2 parse(std::string_view record, size_t max_depth) {
+			JSO2				value;
+			const char *p		= record.data();
+			const char *end = p + record.size();
+			value.load(p, end, max_depth);
+			if(p != end) throw std::invalid_argument("Invalid sequence for Value\n");
+			return value;
+		}
+
+		// records を batch ごとに配り, 読み終えた値を done(index, value) に渡す.
+		// 例外は最初の 1 つだけ残し, 残りの thread にも打ち切らせる.
+		template <class F>
+		void run(const std::vector<std::string_view> &records, const options &opt,
+						 F &&done) {
+			std::atomic<size_t> next	 = 0;
+			std::atomic<bool>		failed = false;
+			std::exception_ptr	error;
+			std::mutex					error_lock;
+
+			auto work = [&] {
+				while(!failed) {
+					const size_t first = next.fetch_add(batch);
+					if(first >= records.size()) break;
+					const size_t last = std::min(first + batch, records.size());
+					try {
+						for(size_t i = first; i < last; ++i)
+							done(i, parse(records[i], opt.max_depth));
+					} catch(...) {
+						std::lock_guard<std::mutex> lock(error_lock);
+						if(!error) error = std::current_exception();
+						failed = true;
+					}
+				}
+			};
+
+			size_t n = opt.threads ? opt.threads : std::thread::hardware_concurrency();
+			n				 = std::clamp<size_t>(n, 1, (records.size() + batch - 1) / batch);
+			std::vector<std::thread> pool;
+			for(size_t i = 1; i < n; ++i) pool.emplace_back(work);
+			work();
+			for(auto &t : pool) t.join();
+
+			if(error) std::rethrow_exception(error);
+		}
+
+	}
+
+	std::vector<std::string_view> split(std::string_view src) {
+		std::vector<std::string_view> records;
+		const char									 *p		= src.data();
+		const char									 *end = p + src.size();
+		while(p < end) {
+			const char *first = p;
+			const char *nl		= find(p, end, '\n');
+			// 行内に文字列かコメントがあれば, その外側の改行まで進める
+			while(1) {
+				const char *quote = find(p, nl, '"');
+				const char *hash	= find(p, quote, '#');
+				if(hash < quote) {
+					p = nl;
+					break;
+				}
+				if(quote == nl) {
+					p = nl;
+					break;
+				}
+				p = quote + 1;
+				while(1) {
+					p = scan::find_quote_or_backslash(p, end);
+					if(p == end || *p == '"') break;
+					p = std::min(p + 2, end);
+				}
+				if(p < end) ++p;
+				if(p > nl) nl = find(p, end, '\n');
+			}
+			if(scan::skip_white_space(first, nl) != nl)
+				records.emplace_back(first, nl - first);
+			p = nl + (nl < end);
+		}
+		return records;
+	}
+
+	std::vector<JSO2> load(std::string_view src, const options &opt) {
+		const auto				records = split(src);
+		std::vector<JSO2> values(records.size());
+		run(records, opt, [&](size_t i, JSO2 &&value) { values[i] = std::move(value); });
+		return values;
+	}
+
+	std::vector<JSO2> load_file(const std::string &path, const options &opt) {
+		MappedFile file(path);
+		return load(file.view(), opt);
+	}
+
+	void for_each(std::string_view src,
+								const std::function<void(size_t, JSO2 &)> &f,
+								const options																&opt) {
+		const auto records = split(src);
+		std::mutex lock;
+
+		if(opt.emit == order::completion) {
+			run(records, opt, [&](size_t i, JSO2 &&value) {
+				std::lock_guard<std::mutex> guard(lock);
+				f(i, value);
+			});
+			return;
+		}
+
+		// 先に読み終えた値は, それより前の行が揃うまで預かる
+		std::vector<JSO2> pending(records.size());
+		std::vector<char> ready(records.size(), false);
+		size_t						emitted = 0;
+		run(records, opt, [&](size_t i, JSO2 &&value) {
+			std::lock_guard<std::mutex> guard(lock);
+			pending[i] = std::move(value);
+			ready[i]	 = true;
+			for(; emitted < records.size() && ready[emitted]; ++emitted) {
+				f(emitted, pending[emitted]);
+				pending[emitted] = JSO2();
+			}
+		});
+	}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "JSO2.h"
+
+// 1 行に 1 つの値を並べた入力 (NDJSON) を行ごとに分け, 複数の thread で読む.
+namespace JSO2::ndjson {
+
+	enum class order : uint8_t {
+		input,			// 入力の順に渡す
+		completion	// 読み終えた順に渡す
+	};
+
+	struct options {
+		size_t threads	 = 0;	 // 0 なら std::thread::hardware_concurrency()
+		order	 emit			 = order::input;
+		size_t max_depth = JSO2::default_max_depth;
+	};
+
+	// 文字列と '#' コメントの外側にある改行で区切る.
+	// 空白とコメントしかない行は含めない.
+	std::vector<std::string_view> split(std::string_view src);
+
+	// 各行を読み, 入力の順に並べて返す. いずれかの行が文法違反なら,
+	// 全ての thread を止めてから最初に見つかった例外を投げ直す.
+	std::vector<JSO2> load(std::string_view src, const options &opt = {});
+	std::vector<JSO2> load_file(const std::string &path, const options &opt = {});
+
+	// 読み終えた値を行番号 (空行を除いた 0 起点) とともに f に渡す.
+	// f は一度に 1 つの thread からしか呼ばれない. opt.emit で順序を選ぶ.
+	void for_each(std::string_view src,
+								const std::function<void(size_t, JSO2 &)> &f,
+								const options																&opt = {});
+
+}
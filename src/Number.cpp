@@ -0,0 +1,169 @@
+#include "Number.h"
+
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace JSO2::number {
+
+	namespace {
+
+		bool is_digit(char c) { return '0' <= c && c <= '9'; }
+
+		// 10^0 .. 10^22 は double で正確に表せる
+		constexpr double exact_power_of_ten[] = {
+				1e0,	1e1,	1e2,	1e3,	1e4,	1e5,	1e6,	1e7,	1e8,	1e9,	1e10, 1e11,
+				1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+	}
+
+	const char *parse(const char *p, const char *end, double &x) {
+		if(end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+			uint64_t bits;
+			if(!parse_hex_bits(p + 2, end, bits)) return nullptr;
+			x = std::bit_cast<double>(bits);
+			return p + hex_length;
+		}
+
+		const char *first		 = p;
+		const bool	negative = p < end && *p == '-';
+		if(negative) ++p;
+		if(p == end || !is_digit(*p)) return nullptr;
+
+		// 上位 19 桁までを mantissa に集め, 残りは exponent に繰り込む
+		uint64_t mantissa	 = 0;
+		int			 digits		 = 0;
+		int			 exponent	 = 0;
+		bool		 truncated = false;
+		bool		 integer	 = true;
+
+		auto push = [&](char c) {
+			if(digits < 19) {
+				mantissa = mantissa * 10 + (c - '0');
+				if(mantissa) ++digits;
+				return true;
+			}
+			if(c != '0') truncated = true;
+			return false;
+		};
+
+		if(*p == '0')
+			++p;
+		else
+			for(; p < end && is_digit(*p); ++p)
+				if(!push(*p)) ++exponent;
+
+		if(p < end && *p == '.') {
+			integer = false;
+			for(++p; p < end && is_digit(*p); ++p)
+				if(push(*p)) --exponent;
+		}
+
+		if(p < end && (*p == 'e' || *p == 'E')) {
+			integer = false;
+			++p;
+			bool negative_exponent = false;
+			if(p < end && (*p == '+' || *p == '-')) negative_exponent = *p++ == '-';
+			if(p == end || !is_digit(*p)) return nullptr;
+			int e = 0;
+			for(; p < end && is_digit(*p); ++p)
+				if(e < 100000) e = e * 10 + (*p - '0');
+			exponent += negative_exponent ? -e : e;
+		}
+
+		if(!truncated) {
+			// 整数 : uint64_t からの変換は正しく丸められる
+			if(integer && exponent == 0) {
+				x = negative ? -double(mantissa) : double(mantissa);
+				return p;
+			}
+			// Clinger の fast path : mantissa と 10 の冪がともに double で正確な場合
+			if(mantissa <= uint64_t(1) << 53 && -22 <= exponent && exponent <= 22) {
+				double m = double(mantissa);
+				m				 = exponent < 0 ? m / exact_power_of_ten[-exponent]
+																: m * exact_power_of_ten[exponent];
+				x				 = negative ? -m : m;
+				return p;
+			}
+			if(mantissa == 0) {
+				x = negative ? -0.0 : 0.0;
+				return p;
+			}
+		}
+
+		// それ以外は std::from_chars (locale 非依存, 正しく丸める) に任せる
+		auto [last, ec] = std::from_chars(first, p, x);
+		if(ec == std::errc::result_out_of_range)
+			x = (exponent + digits > 0 ? std::numeric_limits<double>::infinity()
+																 : 0.0) *
+					(negative ? -1 : 1);
+		else if(ec != std::errc() || last != p)
+			return nullptr;
+		return p;
+	}
+
+	char *format(char *dest, double x) {
+		// std::to_chars は精度を指定しなければ最短の round-trip 表記を返す
+		return std::to_chars(dest, dest + max_length, x).ptr;
+	}
+
+#ifdef __SSE2__
+	// 16 桁を 1 度に検査して 4 bit ずつに直し, 隣り合う 2 桁を 1 byte に詰める
+	bool parse_hex_bits(const char *p, const char *end, uint64_t &bits) {
+		if(end - p < 16) return false;
+		const __m128i v			= _mm_loadu_si128((const __m128i *)p);
+		const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+		// 符号付きの比較なので 0x80 以上の byte はどちらにも入らない
+		const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+																				_mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+		const __m128i alpha =
+				_mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+											_mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+		if(_mm_movemask_epi8(_mm_or_si128(digit, alpha)) != 0xffff) return false;
+
+		const __m128i nibble =
+				_mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(v, _mm_set1_epi8('0'))),
+										 _mm_andnot_si128(digit, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+		// 16 bit の下位 byte が上位の桁
+		const __m128i pair	= _mm_and_si128(
+				 _mm_or_si128(_mm_slli_epi16(nibble, 4), _mm_srli_epi16(nibble, 8)),
+				 _mm_set1_epi16(0xff));
+		const __m128i bytes = _mm_packus_epi16(pair, pair);
+		uint64_t			big_endian;
+		_mm_storel_epi64((__m128i *)&big_endian, bytes);
+		bits = __builtin_bswap64(big_endian);
+		return true;
+	}
+#else
+	bool parse_hex_bits(const char *p, const char *end, uint64_t &bits) {
+		if(end - p < 16) return false;
+		bits = 0;
+		for(int i = 0; i < 16; ++i) {
+			const char c = p[i];
+			int				 n;
+			if('0' <= c && c <= '9')
+				n = c - '0';
+			else if('a' <= (c | 0x20) && (c | 0x20) <= 'f')
+				n = (c | 0x20) - 'a' + 10;
+			else
+				return false;
+			bits = bits << 4 | n;
+		}
+		return true;
+	}
+#endif
+
+	char *format_hex(char *dest, double x) {
+		uint64_t bits = std::bit_cast<uint64_t>(x);
+		*dest++				= '0';
+		*dest++				= 'x';
+		for(int i = 15; i >= 0; --i, bits >>= 4) dest[i] = "0123456789ABCDEF"[bits & 15];
+		return dest + 16;
+	}
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace JSO2::number {
+
+	// [p, end) の先頭を JSON の number として読み, 最も近い double を x に入れる.
+	// 読み終えた位置を返す. 文法に合わない場合は nullptr を返す.
+	const char *parse(const char *p, const char *end, double &x);
+
+	// format が書き込む最大の長さ ("-2.2250738585072014e-308" は 24 文字)
+	constexpr size_t max_length = 32;
+
+	// parse で読み戻すと x に一致する最短の 10 進表記を dest に書き込み,
+	// 書き終えた位置を返す. dest には max_length 以上の領域が必要.
+	char *format(char *dest, double x);
+
+	// 拡張文法 : "0x" に続く 16 桁の 16 進数で IEEE 754 の bit をそのまま表す.
+	// 符号も bit に含むので '-' は付けない. parse はこの形も読む.
+	constexpr size_t hex_length = 18;
+
+	// p から 16 桁の 16 進数 (大文字, 小文字とも) を上位の桁から読む.
+	// 16 桁揃っていなければ false.
+	bool parse_hex_bits(const char *p, const char *end, uint64_t &bits);
+
+	// "0x" と 16 桁の 16 進数 (大文字) を dest に書き込み, 書き終えた位置を返す
+	char *format_hex(char *dest, double x);
+
+}
@@ -0,0 +1,174 @@
+#include "Parallel.h"
+
+#include "Builder.h"
+#include "MappedFile.h"
+#include "Sax.h"
+#include "Scan.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace JSO2::parallel {
+
+	namespace {
+
+		struct range {
+			uint32_t first, last;
+		};
+
+		// 連続する要素の組を, byte 数がほぼ等しくなるように n 個に分ける
+		std::vector<size_t> partition(const std::vector<range> &elements, size_t n) {
+			std::vector<size_t> bounds = {0};
+			const size_t total = elements.back().last - elements.front().first;
+			size_t			 done	 = 0;
+			for(size_t i = 0; i < elements.size(); ++i) {
+				done += elements[i].last - elements[i].first;
+				if(done * n >= total * bounds.size() && bounds.size() < n)
+					bounds.push_back(i + 1);
+			}
+			if(bounds.back() != elements.size()) bounds.push_back(elements.size());
+			return bounds;
+		}
+
+		// 各組を別の thread で処理し, 最初の例外を投げ直す
+		template <class F>
+		void run(size_t groups, F &&work) {
+			std::atomic<size_t> next = 0;
+			std::exception_ptr	error;
+			std::mutex					error_lock;
+			auto								worker = [&] {
+				 for(size_t g; (g = next++) < groups;) {
+					 try {
+						 work(g);
+					 } catch(...) {
+						 std::lock_guard<std::mutex> lock(error_lock);
+						 if(!error) error = std::current_exception();
+					 }
+				 }
+			};
+			std::vector<std::thread> pool;
+			for(size_t i = 1; i < groups; ++i) pool.emplace_back(worker);
+			worker();
+			for(auto &t : pool) t.join();
+			if(error) std::rethrow_exception(error);
+		}
+
+		void load_value(JSO2 &slot, const char *p, const char *end, size_t max_depth,
+										const char *message) {
+			if(!slot.load(p, end, max_depth) || p != end)
+				throw std::invalid_argument(message);
+		}
+
+	}
+
+	bool load(JSO2 &dest, std::string_view src, const options &opt) {
+		const char *begin = src.data();
+		const char *end		= begin + src.size();
+		const char *p			= scan::skip_white_space(begin, end);
+		if(p == end || (*p != '[' && *p != '{') ||
+			 src.size() > std::numeric_limits<uint32_t>::max())
+			return dest.load(src, opt.max_depth);
+		if(opt.max_depth == 0)
+			throw std::length_error("JSO2 : nesting exceeds max_depth\n");
+
+		// 1 段目 : 深さ 1 の ',' で要素を区切る
+		const bool is_object = *p == '{';
+		const char *message	 = is_object ? "Invalid sequence for Object\n"
+																		 : "Invalid sequence for Array\n";
+		const auto					 index = scan::index(p, end);
+		std::vector<range>	 elements;
+		uint32_t						 first = 1;
+		size_t							 depth = 0;
+		auto								 pos	 = index.begin();
+		for(; pos != index.end(); ++pos) {
+			const char c = p[*pos];
+			if(c == '{' || c == '[')
+				++depth;
+			else if(c == '}' || c == ']') {
+				if(--depth == 0) break;
+			} else if(c == ',' && depth == 1) {
+				elements.push_back({first, *pos});
+				first = *pos + 1;
+			}
+		}
+		if(pos == index.end() || p[*pos] != (is_object ? '}' : ']'))
+			throw std::invalid_argument(message);
+		// 最後の ',' の後ろが空なら読み飛ばす (JSO2::load と同じく許す)
+		if(scan::skip_white_space(p + first, p + *pos) != p + *pos)
+			elements.push_back({first, *pos});
+
+		// 2 段目 : 要素の組ごとに読み, 順に繋ぐ
+		JSO2 root;
+		if(is_object)
+			root = JSO2::Object();
+		else
+			root = JSO2::Array();
+		if(!elements.empty()) {
+			size_t n = opt.threads ? opt.threads : std::thread::hardware_concurrency();
+			n				 = std::clamp<size_t>(n, 1, elements.size());
+			const auto	 bounds		 = partition(elements, n);
+			const size_t groups		 = bounds.size() - 1;
+			const size_t max_depth = opt.max_depth - 1;
+
+			if(is_object) {
+				// 組ごとの Object を繋ぐ. 重複した key は後のものが残る.
+				std::vector<JSO2::Object> parts(groups);
+				run(groups, [&](size_t g) {
+					std::string buffer;
+					for(size_t i = bounds[g]; i < bounds[g + 1]; ++i) {
+						const char *q		= p + elements[i].first;
+						const char *last = p + elements[i].last;
+						sax::skip_white_space(q, last);
+						std::string_view key = sax::get_string(q, last, buffer);
+						sax::skip_white_space(q, last);
+						if(sax::peek(q, last) != ':') throw std::invalid_argument(message);
+						JSO2 &slot = parts[g][JSO2::String(key)];
+						slot			 = JSO2();
+						load_value(slot, q + 1, last, max_depth, message);
+					}
+				});
+				JSO2::Object &obj = root;
+				if constexpr(is_ordered<JSO2::Object>)
+					for(size_t g = groups; g-- > 0;) obj.merge(parts[g]);
+				else {
+					// 挿入順を保つため前から繋ぐ. 重複した key は最初の位置に後の値が入る.
+					obj = std::move(parts[0]);
+					for(size_t g = 1; g < groups; ++g)
+						for(auto &[key, val] : parts[g]) obj[std::move(key)] = std::move(val);
+				}
+			} else {
+				JSO2::Array &arr = root;
+				arr.resize(elements.size());
+				run(groups, [&](size_t g) {
+					for(size_t i = bounds[g]; i < bounds[g + 1]; ++i)
+						load_value(arr[i], p + elements[i].first, p + elements[i].last,
+											 max_depth, message);
+				});
+				// JSO2::load と同じく, 数だけなら builder で Numbers に詰める
+				if(std::all_of(arr.begin(), arr.end(),
+											 [](const JSO2 &val) { return val.get_type() == type::Number; })) {
+					JSO2::builder b;
+					b.on_array_begin();
+					for(const JSO2 &val : arr) b.on_number(val);
+					b.on_array_end();
+					root = std::move(b.root);
+				}
+			}
+		}
+		dest = std::move(root);
+		return true;
+	}
+
+	bool load_file(JSO2 &dest, const std::string &path, const options &opt) {
+		MappedFile file(path);
+		return load(dest, file.view(), opt);
+	}
+
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "JSO2.h"
+
+// 1 つの大きな文書を 2 段階で読む.
+// 1 段目で構造文字の位置 (scan::index) を求めて最上位の Array / Object を
+// 要素ごとの範囲に分け, 2 段目で範囲をまとめて複数の thread で読んでから繋ぐ.
+namespace JSO2::parallel {
+
+	struct options {
+		size_t threads	 = 0;	 // 0 なら std::thread::hardware_concurrency()
+		size_t max_depth = JSO2::default_max_depth;
+	};
+
+	// 結果と例外は JSO2::load と同じ. 最上位が Array / Object でない場合と
+	// 4 GiB を超える入力は 1 つの thread で読む.
+	bool load(JSO2 &dest, std::string_view src, const options &opt = {});
+	bool load_file(JSO2 &dest, const std::string &path, const options &opt = {});
+
+}
@@ -0,0 +1,248 @@
+#include "Reader.h"
+
+#include "Base64.h"
+#include "Number.h"
+#include "Sax.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace JSO2 {
+
+	void Reader::feed(const char *data, size_t size) {
+		// 読み終えた分が半分を超えたら捨てる. 毎回捨てると途中で切れた長い token を
+		// feed のたびに動かすことになる
+		if(_pos > _buffer.size() / 2) {
+			_buffer.erase(0, _pos);
+			_scan = _scan > _pos ? _scan - _pos : 0;
+			_pos	= 0;
+		}
+		_buffer.append(data, size);
+		_text = {};
+	}
+
+	// 閉じた引用符まで届いていれば復号する. 届いていなければ探し終えた位置を覚える.
+	bool Reader::string(const char *&p, const char *end) {
+		const char *begin = _buffer.data();
+		const char *q			= size_t(p - begin) < _scan ? begin + _scan : p + 1;
+		while(1) {
+			q = scan::find_quote_or_backslash(q, end);
+			if(q < end && *q == '"') break;
+			if(end - q < 2) {
+				_scan = q - begin;
+				return false;
+			}
+			q += 2;
+		}
+		_text = sax::get_string(p, q + 1, _scratch);
+		_scan = 0;
+		return true;
+	}
+
+	// 数の後ろに続く文字が届くまで確定できない
+	bool Reader::number(const char *&p, const char *end) {
+		const char *q = p;
+		// 'x' と 16 進の桁は number::format_hex の形
+		while(q < end && ((('0' <= *q && *q <= '9') || *q == '-' || *q == '+' ||
+											 *q == '.' || *q == 'x' || *q == 'X' ||
+											 ('a' <= (*q | 0x20) && (*q | 0x20) <= 'f'))))
+			++q;
+		if(q == end && !_finished) return false;
+		if(number::parse(p, q, _number) != q)
+			throw std::invalid_argument("Invalid sequence for Number\n");
+		p = q;
+		return true;
+	}
+
+	// 閉じた ')' まで届くまで確定できない. 探し終えた位置を覚える.
+	bool Reader::block(const char *&p, const char *end) {
+		const char *begin = _buffer.data();
+		const char *q			= p + std::min<size_t>(5, end - p);
+		if(begin + _scan > q) q = begin + _scan;
+		q = base64::find_end(q, end);
+		if(q == end && !_finished) {
+			_scan = q - begin;
+			return false;
+		}
+		_scan								= 0;
+		const sax::block b = sax::get_block(p, end);
+		_numbers.resize(b.size);
+		sax::decode_block(b, _numbers.data());
+		return true;
+	}
+
+	bool Reader::literal(const char *&p, const char *end) {
+		const std::string_view word = *p == 't'		? "true"
+																	: *p == 'f' ? "false"
+																							: "null";
+		if(size_t(end - p) < word.size()) {
+			if(!_finished && std::memcmp(p, word.data(), end - p) == 0) return false;
+			throw std::invalid_argument("Invalid sequence for Value\n");
+		}
+		sax::get_literal(p, end, word);
+		_boolean = *word.data() == 't';
+		return true;
+	}
+
+	Reader::token Reader::close(const char *&p) {
+		++p;
+		const type t = _stack.back();
+		_stack.pop_back();
+		_expect = _stack.empty() ? expect::value : expect::separator;
+		return t == type::Object ? token::object_end : token::array_end;
+	}
+
+	Reader::token Reader::next() {
+		const char *begin = _buffer.data();
+		const char *end		= begin + _buffer.size();
+		const char *p			= begin + _pos;
+		token				ret		= token::none;
+
+		while(ret == token::none) {
+			// 空白とコメント. 行末の届いていないコメントは次の feed に持ち越す
+			if(_comment) {
+				const char *nl = (const char *)std::memchr(p, '\n', end - p);
+				p							 = nl ? nl + 1 : end;
+				_comment			 = !nl;
+			}
+			p = scan::skip_white_space_block(p, end);
+			if(p < end && *p == '#') {
+				_comment = true;
+				continue;
+			}
+			if(p == end) {
+				if(_finished && !(_stack.empty() && _expect == expect::value))
+					throw std::invalid_argument("Invalid sequence for Value\n");
+				break;
+			}
+
+			const char *first = p;
+			bool				done	= true;
+			switch(_expect) {
+				case expect::separator:
+					if(*p == (_stack.back() == type::Object ? '}' : ']'))
+						ret = close(p);
+					else if(*p == ',') {
+						++p;
+						_expect = _stack.back() == type::Object ? expect::key : expect::value;
+					} else
+						throw std::invalid_argument(_stack.back() == type::Object
+																						? "Invalid sequence for Object\n"
+																						: "Invalid sequence for Array\n");
+					break;
+				case expect::colon:
+					if(*p != ':') throw std::invalid_argument("Invalid sequence for Object\n");
+					++p;
+					_expect = expect::value;
+					break;
+				case expect::first_key:
+					if(*p == '}') {
+						ret = close(p);
+						break;
+					}
+					[[fallthrough]];
+				case expect::key:
+					if(*p != '"') throw std::invalid_argument("Invalid sequence for Object\n");
+					if((done = string(p, end))) {
+						ret			= token::key;
+						_expect = expect::colon;
+					}
+					break;
+				case expect::first_value:
+					if(*p == ']') {
+						ret = close(p);
+						break;
+					}
+					[[fallthrough]];
+				case expect::value: {
+					const char *q = p;
+					switch(sax::detect_type(q, end)) {
+						case type::Object:
+						case type::Array:
+							if(*p == '@') {
+								if((done = block(p, end))) ret = token::numbers;
+								break;
+							}
+							if(_stack.size() >= _max_depth)
+								throw std::length_error("JSO2 : nesting exceeds max_depth\n");
+							_stack.push_back(*p == '{' ? type::Object : type::Array);
+							ret			= *p == '{' ? token::object_begin : token::array_begin;
+							_expect = *p == '{' ? expect::first_key : expect::first_value;
+							++p;
+							continue;
+						case type::String:
+							if((done = string(p, end))) ret = token::string;
+							break;
+						case type::Number:
+							if((done = number(p, end))) ret = token::number;
+							break;
+						case type::True:
+						case type::False:
+							if((done = literal(p, end))) ret = token::boolean;
+							break;
+						case type::Null:
+							if((done = literal(p, end))) ret = token::null;
+							break;
+						default:
+							throw std::invalid_argument("Invalid sequence for Value\n");
+					}
+					if(done) _expect = _stack.empty() ? expect::value : expect::separator;
+				} break;
+			}
+			if(!done) {
+				// 途中で切れた token は先頭から読み直す
+				if(_finished) throw std::invalid_argument("Invalid sequence for Value\n");
+				p = first;
+				break;
+			}
+		}
+		_pos = p - begin;
+		return ret;
+	}
+
+	// token を JSO2::load と同じ builder に渡し, 数だけの Array は同じく詰める
+	bool Reader::next(JSO2 &value) {
+		while(1) {
+			switch(next()) {
+				case token::none:
+					return false;
+				case token::object_begin:
+					_builder.on_object_begin();
+					continue;
+				case token::array_begin:
+					_builder.on_array_begin();
+					continue;
+				case token::key:
+					_builder.on_key(_text);
+					continue;
+				case token::object_end:
+					_builder.on_object_end();
+					break;
+				case token::array_end:
+					_builder.on_array_end();
+					break;
+				case token::string:
+					_builder.on_string(_text);
+					break;
+				case token::number:
+					_builder.on_number(_number);
+					break;
+				case token::numbers:
+					std::copy(_numbers.begin(), _numbers.end(), _builder.on_numbers(_numbers.size()));
+					break;
+				case token::boolean:
+					_builder.on_bool(_boolean);
+					break;
+				default:
+					_builder.on_null();
+					break;
+			}
+			if(_builder.done()) {
+				value = std::move(_builder.root);
+				return true;
+			}
+		}
+	}
+
+}
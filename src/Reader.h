@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Builder.h"
+#include "JSO2.h"
+
+namespace JSO2 {
+
+	// 分割して届く入力を feed で受け取り, 読めるところまで token または値を返す.
+	// 途中で切れた token は次の feed まで保留し, それ以前の入力は捨てる.
+	// 空白で区切って複数の値を続けて送ってもよい.
+	class Reader {
+	public:
+		enum class token : uint8_t {
+			none,	 // 入力が足りない (finish 後なら入力の終わり)
+			object_begin,
+			object_end,
+			array_begin,
+			array_end,
+			key,
+			string,
+			number,
+			numbers,	// block (sax::get_block) の数の Array
+			boolean,
+			null
+		};
+
+	private:
+		// 次に読むもの
+		enum class expect : uint8_t {
+			value,
+			first_value,	// value または ']'
+			key,
+			first_key,	// key または '}'
+			colon,
+			separator	 // ',' または閉じ括弧
+		};
+
+		std::string				_buffer;	// 入力. 先頭の _pos byte は読み終えた分
+		size_t						_pos			= 0;
+		size_t						_scan			= 0;	// 途中で切れた文字列や block を _buffer のここから探し直す
+		bool							_comment	= false;
+		bool							_finished = false;
+		size_t						_max_depth;
+		std::vector<type> _stack;
+		expect						_expect = expect::value;
+
+		std::string			 _scratch;
+		std::string_view _text;
+		double					 _number	= 0;
+		std::vector<double> _numbers;
+		bool						 _boolean = false;
+
+		// next(JSO2&) で組み立て中の値
+		JSO2::builder _builder;
+
+		bool	string(const char *&p, const char *end);
+		bool	number(const char *&p, const char *end);
+		bool	block(const char *&p, const char *end);
+		bool	literal(const char *&p, const char *end);
+		token close(const char *&p);
+
+	public:
+		explicit Reader(size_t max_depth = JSO2::default_max_depth)
+				: _max_depth(max_depth) {}
+
+		void feed(const char *data, size_t size);
+		void feed(std::string_view data) { feed(data.data(), data.size()); }
+		// これ以上入力がないことを伝える. 途中で切れた token は文法違反になる.
+		void finish() { _finished = true; }
+
+		// 次の token を返す. text, number, numbers, boolean は次の feed / next まで有効.
+		token						 next();
+		std::string_view text() const { return _text; }
+		double					 number() const { return _number; }
+		std::span<const double> numbers() const { return _numbers; }
+		bool						 boolean() const { return _boolean; }
+
+		// 次の値が全て揃ったら value に入れて true を返す.
+		// 揃わなければ途中まで組んだ木を保持して false を返す.
+		// 1 つの値の途中で next() と混ぜて使ってはならない.
+		bool next(JSO2 &value);
+
+		size_t depth() const { return _stack.size(); }
+		size_t buffered() const { return _buffer.size() - _pos; }
+	};
+
+}
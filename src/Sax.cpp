@@ -0,0 +1,189 @@
+#include "Sax.h"
+
+#include "Base64.h"
+#include "Number.h"
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+namespace JSO2::sax {
+
+	double get_number(const char *&p, const char *end) {
+		double x;
+		if(const char *last = number::parse(p, end, x))
+			p = last;
+		else
+			throw std::invalid_argument("Invalid sequence for Number\n");
+		return x;
+	}
+
+	namespace {
+
+		int from_hex(char c) {
+			if('0' <= c && c <= '9') return c - '0';
+			if('A' <= c && c <= 'F') return c - 'A' + 10;
+			if('a' <= c && c <= 'f') return c - 'a' + 10;
+			return -1;
+		}
+
+		uint32_t get_code_unit(const char *&p, const char *end) {
+			if(end - p < 4) throw std::invalid_argument("Invalid sequence for String\n");
+			uint32_t u = 0;
+			for(int i = 0; i < 4; ++i) {
+				int h = from_hex(*p++);
+				if(h < 0) throw std::invalid_argument("Invalid sequence for String\n");
+				u = u << 4 | h;
+			}
+			return u;
+		}
+
+		void append_utf8(std::string &dest, uint32_t u) {
+			if(u < 0x80)
+				dest.push_back(u);
+			else if(u < 0x800) {
+				dest.push_back(0xC0 | u >> 6);
+				dest.push_back(0x80 | (u & 0x3F));
+			} else if(u < 0x10000) {
+				dest.push_back(0xE0 | u >> 12);
+				dest.push_back(0x80 | (u >> 6 & 0x3F));
+				dest.push_back(0x80 | (u & 0x3F));
+			} else {
+				dest.push_back(0xF0 | u >> 18);
+				dest.push_back(0x80 | (u >> 12 & 0x3F));
+				dest.push_back(0x80 | (u >> 6 & 0x3F));
+				dest.push_back(0x80 | (u & 0x3F));
+			}
+		}
+
+	}
+
+	// 引用符とエスケープの間を buffer へ一括でコピーし, エスケープの位置でだけ復号する.
+	std::string_view get_string(const char *&p, const char *end,
+															std::string &buffer) {
+		if(peek(p, end) != '\"')
+			throw std::invalid_argument("Invalid sequence for String\n");
+		++p;
+		const char *run = scan::find_quote_or_backslash(p, end);
+		if(run < end && *run == '\"') {
+			std::string_view ret(p, run - p);
+			p = run + 1;
+			return ret;
+		}
+		buffer.clear();
+		while(1) {
+			buffer.append(p, run);
+			p = run;
+			if(p == end) break;
+			if(*p++ == '\"') return buffer;
+			if(p == end) break;
+			switch(*p++) {
+				case '"':
+					buffer.push_back('\"');
+					break;
+				case '\\':
+					buffer.push_back('\\');
+					break;
+				case '/':
+					buffer.push_back('/');
+					break;
+				case 'b':
+					buffer.push_back('\b');
+					break;
+				case 'f':
+					buffer.push_back('\f');
+					break;
+				case 'n':
+					buffer.push_back('\n');
+					break;
+				case 'r':
+					buffer.push_back('\r');
+					break;
+				case 't':
+					buffer.push_back('\t');
+					break;
+				case 'u': {
+					uint32_t u = get_code_unit(p, end);
+					if(0xD800 <= u && u < 0xDC00 && end - p >= 2 && p[0] == '\\' &&
+						 p[1] == 'u') {
+						p += 2;
+						uint32_t low = get_code_unit(p, end);
+						if(low < 0xDC00 || 0xE000 <= low)
+							throw std::invalid_argument("Invalid sequence for String\n");
+						u = 0x10000 + ((u - 0xD800) << 10) + (low - 0xDC00);
+					}
+					append_utf8(buffer, u);
+				} break;
+				default:
+					throw std::invalid_argument("Invalid sequence for String\n");
+			}
+			run = scan::find_quote_or_backslash(p, end);
+		}
+		throw std::invalid_argument("Invalid sequence for String\n");
+	}
+
+	void get_literal(const char *&p, const char *end, std::string_view word) {
+		if(size_t(end - p) < word.size() ||
+			 std::memcmp(p, word.data(), word.size()) != 0)
+			throw std::invalid_argument("Invalid sequence for Value\n");
+		p += word.size();
+	}
+
+	block get_block(const char *&p, const char *end) {
+		if(end - p < 5 || p[0] != '@' || p[4] != '(')
+			throw std::invalid_argument("Invalid sequence for Array\n");
+		const std::string_view name(p + 1, 3);
+		block									 b;
+		if(name == "f64")
+			b.kind = element::f64;
+		else if(name == "f32")
+			b.kind = element::f32;
+		else if(name == "i32")
+			b.kind = element::i32;
+		else
+			throw std::invalid_argument("Invalid sequence for Array\n");
+		b.first						 = p + 5;
+		b.last						 = base64::find_end(b.first, end);
+		const size_t bytes = base64::decoded_length(b.first, b.last);
+		const size_t width = b.kind == element::f64 ? 8 : 4;
+		if(b.last == end || *b.last != ')' || bytes == size_t(-1) || bytes % width)
+			throw std::invalid_argument("Invalid sequence for Array\n");
+		b.size = bytes / width;
+		p			 = b.last + 1;
+		return b;
+	}
+
+	// 4 byte の要素は dest の後ろ半分に復号してから前へ広げる.
+	// i 番目を書く時には i 番目までを読み終えているので重ならない.
+	void decode_block(const block &b, double *dest) {
+		const size_t	 width = b.kind == element::f64 ? 8 : 4;
+		unsigned char *bytes = (unsigned char *)dest + (8 - width) * b.size;
+		if(base64::decode(b.first, b.last, bytes) != bytes + width * b.size)
+			throw std::invalid_argument("Invalid sequence for Array\n");
+		constexpr bool swap = std::endian::native == std::endian::big;
+		switch(b.kind) {
+			case element::f64:
+				if constexpr(swap)
+					for(size_t i = 0; i < b.size; ++i)
+						dest[i] = std::bit_cast<double>(__builtin_bswap64(std::bit_cast<uint64_t>(dest[i])));
+				break;
+			case element::f32:
+				for(size_t i = 0; i < b.size; ++i) {
+					uint32_t u;
+					std::memcpy(&u, bytes + 4 * i, 4);
+					if constexpr(swap) u = __builtin_bswap32(u);
+					dest[i] = std::bit_cast<float>(u);
+				}
+				break;
+			case element::i32:
+				for(size_t i = 0; i < b.size; ++i) {
+					uint32_t u;
+					std::memcpy(&u, bytes + 4 * i, 4);
+					if constexpr(swap) u = __builtin_bswap32(u);
+					dest[i] = int32_t(u);
+				}
+				break;
+		}
+	}
+
+}
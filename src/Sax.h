@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "JSO2.h"
+#include "MappedFile.h"
+#include "Scan.h"
+
+namespace JSO2::sax {
+
+	// 木を作らずに読み進め, 値ごとに handler の関数を呼ぶ.
+	// 必要な関数だけを定義できるよう, 何もしない既定の実装を用意する.
+	// on_key, on_string に渡す string_view はその呼び出しの間だけ有効で,
+	// エスケープを含まなければ入力を, 含めば復号した一時領域を指す.
+	// block (get_block) は on_numbers(const block &) を定義した handler にはそのまま渡し,
+	// 定義しない handler には on_array_begin, on_number, on_array_end の順に渡す.
+	struct handler {
+		void on_object_begin() {}
+		void on_object_end() {}
+		void on_array_begin() {}
+		void on_array_end() {}
+		void on_key(std::string_view) {}
+		void on_string(std::string_view) {}
+		void on_number(double) {}
+		void on_bool(bool) {}
+		void on_null() {}
+	};
+
+	inline char peek(const char *p, const char *end) {
+		return p < end ? *p : '\0';
+	}
+
+	inline void skip_white_space(const char *&p, const char *end) {
+		p = scan::skip_white_space(p, end);
+	}
+
+	// 空白を読み飛ばし, 次の値の型を先頭の 1 文字から判定する.
+	// 値を始められない文字なら type::TotalTypes を返す.
+	inline type detect_type(const char *&p, const char *end) {
+		skip_white_space(p, end);
+		switch(peek(p, end)) {
+			case '{':
+				return type::Object;
+			case '[':
+				return type::Array;
+			case '"':
+				return type::String;
+			case '-':
+			case '0':
+			case '1':
+			case '2':
+			case '3':
+			case '4':
+			case '5':
+			case '6':
+			case '7':
+			case '8':
+			case '9':
+				return type::Number;
+			case '@':
+				return type::Array;
+			case 't':
+				return type::True;
+			case 'f':
+				return type::False;
+			case 'n':
+				return type::Null;
+			default:
+				return type::TotalTypes;
+		}
+	}
+
+	double get_number(const char *&p, const char *end);
+	// エスケープを含まない文字列は入力をそのまま参照して返す.
+	// 含む場合は buffer に復号して返す.
+	std::string_view get_string(const char *&p, const char *end,
+															std::string &buffer);
+	void						 get_literal(const char *&p, const char *end,
+															 std::string_view word);
+
+	// 拡張文法 : '@' と要素の型 ("f64", "f32", "i32") に続けて, little endian の値を
+	// 隙間なく並べた byte 列を base64 で書き '(' と ')' で囲んだ数の Array.
+	// 例えば [1, 2] は @f64(AAAAAAAA8D8AAAAAAAAAQA==). 要素は double に直して読む.
+	// ':' を含まないので scan::index には現れない.
+	enum class element : uint8_t { f64, f32, i32 };
+	struct block {
+		element			kind;
+		const char *first, *last;	 // base64 の範囲
+		size_t			size;					 // 要素の数
+	};
+	// 型と base64 の範囲を読んで ')' の後ろまで p を進める. 復号は decode_block で行う
+	block get_block(const char *&p, const char *end);
+	// 要素を dest[0, b.size) に書き込む
+	void	decode_block(const block &b, double *dest);
+
+	// 再帰せず, 開いている Object / Array の種類を stack に積んで読む.
+	// 空の入力なら false, 文法違反は std::invalid_argument,
+	// max_depth を超える入れ子は std::length_error を投げる.
+	template <class Handler>
+	bool parse(const char *&p, const char *end, Handler &h,
+						 size_t max_depth = JSO2::default_max_depth) {
+		if(detect_type(p, end) == type::TotalTypes) {
+			if(p == end) return false;
+			throw std::invalid_argument("Invalid sequence for Value\n");
+		}
+
+		std::vector<type>		stack;
+		std::string					buffer;
+		std::vector<double> numbers;
+		while(1) {
+			const type t			= detect_type(p, end);
+			bool			 opened = false;
+			switch(t) {
+				case type::Object:
+				case type::Array:
+					if(*p == '@') {
+						const block b = get_block(p, end);
+						if constexpr(requires { h.on_numbers(b); })
+							h.on_numbers(b);
+						else {
+							numbers.resize(b.size);
+							decode_block(b, numbers.data());
+							h.on_array_begin();
+							for(double x : numbers) h.on_number(x);
+							h.on_array_end();
+						}
+						break;
+					}
+					if(t == type::Object)
+						h.on_object_begin();
+					else
+						h.on_array_begin();
+					++p;
+					skip_white_space(p, end);
+					if(peek(p, end) == (t == type::Object ? '}' : ']')) {
+						++p;
+						if(t == type::Object)
+							h.on_object_end();
+						else
+							h.on_array_end();
+						break;
+					}
+					if(stack.size() >= max_depth)
+						throw std::length_error("JSO2 : nesting exceeds max_depth\n");
+					stack.push_back(t);
+					opened = true;
+					break;
+				case type::String:
+					h.on_string(get_string(p, end, buffer));
+					break;
+				case type::Number:
+					h.on_number(get_number(p, end));
+					break;
+				case type::True:
+					get_literal(p, end, "true");
+					h.on_bool(true);
+					break;
+				case type::False:
+					get_literal(p, end, "false");
+					h.on_bool(false);
+					break;
+				case type::Null:
+					get_literal(p, end, "null");
+					h.on_null();
+					break;
+				default:
+					throw std::invalid_argument("Invalid sequence for Value\n");
+			}
+
+			// 閉じられた container を降ろす
+			while(!opened && !stack.empty()) {
+				const type top	 = stack.back();
+				const char close = top == type::Object ? '}' : ']';
+				skip_white_space(p, end);
+				if(peek(p, end) != close) {
+					if(peek(p, end) != ',')
+						throw std::invalid_argument(top == type::Object
+																						? "Invalid sequence for Object\n"
+																						: "Invalid sequence for Array\n");
+					++p;
+					skip_white_space(p, end);
+					if(peek(p, end) != close) break;
+				}
+				++p;
+				stack.pop_back();
+				if(top == type::Object)
+					h.on_object_end();
+				else
+					h.on_array_end();
+			}
+			if(stack.empty()) break;
+
+			if(stack.back() == type::Object) {
+				std::string_view key = get_string(p, end, buffer);
+				skip_white_space(p, end);
+				if(peek(p, end) != ':')
+					throw std::invalid_argument("Invalid sequence for Object\n");
+				++p;
+				h.on_key(key);
+			}
+		}
+		skip_white_space(p, end);
+		return true;
+	}
+
+	template <class Handler>
+	bool parse(std::string_view src, Handler &h,
+						 size_t max_depth = JSO2::default_max_depth) {
+		const char *p = src.data();
+		return parse(p, src.data() + src.size(), h, max_depth);
+	}
+
+	template <class Handler>
+	bool parse_file(const std::string &path, Handler &h,
+									size_t max_depth = JSO2::default_max_depth) {
+		MappedFile file(path);
+		return parse(file.view(), h, max_depth);
+	}
+
+}
@@ -0,0 +1,302 @@
+#include "Scan.h"
+
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define JSO2_SCAN_X86
+#endif
+
+namespace JSO2::scan {
+
+	bool is_structural(char c) {
+		switch(c) {
+			case '{':
+			case '}':
+			case '[':
+			case ']':
+			case ':':
+			case ',':
+				return true;
+		}
+		return false;
+	}
+
+	namespace {
+
+		Masks classify_scalar(const char *p) {
+			Masks m = {};
+			for(int i = 0; i < 64; ++i) {
+				const uint64_t bit = uint64_t(1) << i;
+				if(is_white_space(p[i])) m.white_space |= bit;
+				if(p[i] == '"') m.quote |= bit;
+				if(p[i] == '\\') m.backslash |= bit;
+				if(is_structural(p[i])) m.structural |= bit;
+				if(p[i] == '#') m.comment |= bit;
+				if(p[i] == '\n') m.newline |= bit;
+			}
+			return m;
+		}
+
+		const char *skip_white_space_scalar(const char *p, const char *end) {
+			while(p < end && is_white_space(*p)) ++p;
+			return p;
+		}
+
+		const char *find_quote_or_backslash_scalar(const char *p,
+																							 const char *end) {
+			while(p < end && *p != '"' && *p != '\\') ++p;
+			return p;
+		}
+
+#ifdef JSO2_SCAN_X86
+		// 16 byte 単位
+		struct sse2 {
+			using reg = __m128i;
+			static constexpr size_t width = 16;
+
+			static reg load(const char *p) {
+				return _mm_loadu_si128((const reg *)p);
+			}
+			static reg eq(reg v, char c) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(c)); }
+			static reg any(reg a, reg b) { return _mm_or_si128(a, b); }
+			static uint32_t mask(reg v) { return _mm_movemask_epi8(v); }
+			static constexpr uint32_t full = 0xFFFF;
+		};
+
+		// 32 byte 単位
+		struct avx2 {
+			using reg = __m256i;
+			static constexpr size_t width = 32;
+
+			__attribute__((target("avx2"))) static reg load(const char *p) {
+				return _mm256_loadu_si256((const reg *)p);
+			}
+			__attribute__((target("avx2"))) static reg eq(reg v, char c) {
+				return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+			}
+			__attribute__((target("avx2"))) static reg any(reg a, reg b) {
+				return _mm256_or_si256(a, b);
+			}
+			__attribute__((target("avx2"))) static uint32_t mask(reg v) {
+				return _mm256_movemask_epi8(v);
+			}
+			static constexpr uint32_t full = 0xFFFFFFFF;
+		};
+
+#define kernel(_isa)                                                       \
+	template <>                                                              \
+	__attribute__((target(#_isa))) const char *skip_white_space_simd<_isa>(  \
+			const char *p, const char *end) {                                    \
+		using V = _isa;                                                        \
+		for(; p + V::width <= end; p += V::width) {                            \
+			auto		 v = V::load(p);                                             \
+			uint32_t m = V::mask(V::any(V::any(V::eq(v, ' '), V::eq(v, '\n')),   \
+																	V::any(V::eq(v, '\r'), V::eq(v, '\t'))));  \
+			if(m != V::full) return p + __builtin_ctz(~m);                       \
+		}                                                                      \
+		return skip_white_space_scalar(p, end);                                \
+	}                                                                        \
+	template <>                                                              \
+	__attribute__((target(#_isa))) const char *                              \
+			find_quote_or_backslash_simd<_isa>(const char *p, const char *end) { \
+		using V = _isa;                                                        \
+		for(; p + V::width <= end; p += V::width) {                            \
+			auto		 v = V::load(p);                                             \
+			uint32_t m = V::mask(V::any(V::eq(v, '"'), V::eq(v, '\\')));         \
+			if(m) return p + __builtin_ctz(m);                                   \
+		}                                                                      \
+		return find_quote_or_backslash_scalar(p, end);                         \
+	}                                                                        \
+	template <>                                                              \
+	__attribute__((target(#_isa))) Masks classify_simd<_isa>(const char *p) { \
+		using V = _isa;                                                        \
+		Masks m = {};                                                          \
+		for(size_t i = 0; i < 64; i += V::width) {                             \
+			auto v	 = V::load(p + i);                                           \
+			auto ws	 = V::any(V::any(V::eq(v, ' '), V::eq(v, '\n')),             \
+												V::any(V::eq(v, '\r'), V::eq(v, '\t')));           \
+			auto st	 = V::any(V::any(V::any(V::eq(v, '{'), V::eq(v, '}')),       \
+															V::any(V::eq(v, '['), V::eq(v, ']'))),       \
+												V::any(V::eq(v, ':'), V::eq(v, ',')));             \
+			m.white_space |= uint64_t(V::mask(ws)) << i;                         \
+			m.quote |= uint64_t(V::mask(V::eq(v, '"'))) << i;                    \
+			m.backslash |= uint64_t(V::mask(V::eq(v, '\\'))) << i;               \
+			m.structural |= uint64_t(V::mask(st)) << i;                          \
+			m.comment |= uint64_t(V::mask(V::eq(v, '#'))) << i;                  \
+			m.newline |= uint64_t(V::mask(V::eq(v, '\n'))) << i;                 \
+		}                                                                      \
+		return m;                                                              \
+	}
+
+		template <class V>
+		const char *skip_white_space_simd(const char *p, const char *end);
+		template <class V>
+		const char *find_quote_or_backslash_simd(const char *p, const char *end);
+		template <class V>
+		Masks classify_simd(const char *p);
+
+		kernel(sse2);
+		kernel(avx2);
+#undef kernel
+#endif
+
+		struct kernels {
+			const char *(*skip_white_space)(const char *, const char *);
+			const char *(*find_quote_or_backslash)(const char *, const char *);
+			Masks (*classify)(const char *);
+		};
+
+		// isa の順に並べる. 定数で初期化されるので, 静的初期化の順序によらず使える
+		constexpr kernels table[] = {
+				{skip_white_space_scalar, find_quote_or_backslash_scalar, classify_scalar},
+#ifdef JSO2_SCAN_X86
+				{skip_white_space_simd<sse2>, find_quote_or_backslash_simd<sse2>, classify_simd<sse2>},
+				{skip_white_space_simd<avx2>, find_quote_or_backslash_simd<avx2>, classify_simd<avx2>},
+#else
+				{skip_white_space_scalar, find_quote_or_backslash_scalar, classify_scalar},
+				{skip_white_space_scalar, find_quote_or_backslash_scalar, classify_scalar},
+#endif
+		};
+
+		// 使用中の kernel. 最初に使うときに detect() の結果で埋める.
+		// use() と並行に読まれるので atomic に入れ替える
+		constinit std::atomic<const kernels *> active{nullptr};
+
+		const kernels &kernel() {
+			const kernels *k = active.load(std::memory_order_relaxed);
+			if(k) return *k;
+			const kernels *detected = &table[size_t(detect())];
+			// 先に use() されていればそちらを使う
+			if(active.compare_exchange_strong(k, detected, std::memory_order_relaxed)) return *detected;
+			return *k;
+		}
+
+	}
+
+	isa detect() {
+#ifdef JSO2_SCAN_X86
+		__builtin_cpu_init();
+		if(__builtin_cpu_supports("avx2")) return isa::avx2;
+		if(__builtin_cpu_supports("sse2")) return isa::sse2;
+#endif
+		return isa::scalar;
+	}
+
+	isa current() { return isa(&kernel() - table); }
+
+	void use(isa i) {
+		if(i > detect()) i = detect();
+		active.store(&table[size_t(i)], std::memory_order_relaxed);
+	}
+
+	Masks classify(const char *p) { return kernel().classify(p); }
+
+	const char *skip_white_space_block(const char *p, const char *end) {
+		return kernel().skip_white_space(p, end);
+	}
+
+	const char *find_quote_or_backslash(const char *p, const char *end) {
+		return kernel().find_quote_or_backslash(p, end);
+	}
+
+	namespace {
+
+		// bit i 以下の quote の数の偶奇. 文字列の内側 (開く '"' を含む) が 1 になる.
+		uint64_t prefix_xor(uint64_t x) {
+			x ^= x << 1;
+			x ^= x << 2;
+			x ^= x << 4;
+			x ^= x << 8;
+			x ^= x << 16;
+			x ^= x << 32;
+			return x;
+		}
+
+		// block を跨いで持ち越す状態
+		struct carry {
+			bool in_string	= false;
+			bool escaped		= false;	// 直前が対になっていない '\\'
+			bool in_comment = false;
+		};
+
+		// コメントを含む block は 1 文字ずつ状態を追う
+		uint64_t index_scalar(const char *p, carry &c) {
+			uint64_t bits = 0;
+			for(int i = 0; i < 64; ++i) {
+				const char ch = p[i];
+				if(c.in_comment)
+					c.in_comment = ch != '\n';
+				else if(c.in_string) {
+					if(c.escaped)
+						c.escaped = false;
+					else if(ch == '\\')
+						c.escaped = true;
+					else if(ch == '"')
+						c.in_string = false;
+				} else if(ch == '#')
+					c.in_comment = true;
+				else if(ch == '"') {
+					c.in_string = true;
+					bits |= uint64_t(1) << i;
+				} else if(is_structural(ch))
+					bits |= uint64_t(1) << i;
+			}
+			return bits;
+		}
+
+	}
+
+	std::vector<uint32_t> index(const char *p, const char *end) {
+		std::vector<uint32_t> ret;
+		const char					 *first = p;
+		carry									c;
+		char									tail[64];
+		for(; p < end; p += 64) {
+			const char *block = p;
+			if(end - p < 64) {
+				std::memset(tail, ' ', sizeof(tail));
+				std::memcpy(tail, p, end - p);
+				block = tail;
+			}
+			const Masks m = classify(block);
+
+			const carry entry = c;
+			uint64_t		bits;
+			if(c.in_comment)
+				bits = index_scalar(block, c);
+			else {
+				// '\\' の直後の文字 (連続する '\\' は 2 つで 1 組) を escape 済みとする
+				uint64_t escaped = 0;
+				if(m.backslash || c.escaped) {
+					bool e = c.escaped;
+					for(int i = 0; i < 64; ++i) {
+						if(e) {
+							escaped |= uint64_t(1) << i;
+							e = false;
+						} else
+							e = m.backslash >> i & 1;
+					}
+					c.escaped = e;
+				}
+				const uint64_t quote		 = m.quote & ~escaped;
+				const uint64_t in_string = prefix_xor(quote) ^ (c.in_string ? ~uint64_t(0) : 0);
+				if(m.comment & ~in_string) {
+					// 文字列の外に '#' がある. block の先頭から 1 文字ずつやり直す
+					c		 = entry;
+					bits = index_scalar(block, c);
+				} else {
+					bits				= (m.structural & ~in_string) | (quote & in_string);
+					c.in_string = in_string >> 63;
+				}
+			}
+
+			const uint32_t offset = p - first;
+			for(; bits; bits &= bits - 1)
+				ret.push_back(offset + __builtin_ctzll(bits));
+		}
+		return ret;
+	}
+
+}
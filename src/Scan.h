@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace JSO2::scan {
+
+	enum class isa { scalar, sse2, avx2 };
+
+	// 実行時に検出した命令セット (初期値) と現在使用中の命令セット
+	isa	 detect();
+	isa	 current();
+	void use(isa i);
+
+	inline bool is_white_space(char c) {
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+	}
+
+	bool is_structural(char c);
+
+	// 64 byte 分の分類結果. bit i が p[i] に対応する.
+	struct Masks {
+		uint64_t white_space;
+		uint64_t quote;
+		uint64_t backslash;
+		uint64_t structural;	// { } [ ] : ,
+		uint64_t comment;			// #
+		uint64_t newline;
+	};
+
+	Masks classify(const char *p);
+
+	const char *skip_white_space_block(const char *p, const char *end);
+	const char *find_quote_or_backslash(const char *p, const char *end);
+
+	// 文字列とコメントの外側にある { } [ ] : , と, 文字列を開く '"' の位置を
+	// 先頭から順に返す (simdjson の stage 1 に相当). 位置は 32 bit に収まること.
+	std::vector<uint32_t> index(const char *p, const char *end);
+
+	// 空白と '#' から行末までのコメントを読み飛ばす
+	inline const char *skip_white_space(const char *p, const char *end) {
+		if(p < end && !is_white_space(*p) && *p != '#') return p;
+		while(1) {
+			p = skip_white_space_block(p, end);
+			if(p == end || *p != '#') return p;
+			while(p < end && *p != '\n') ++p;
+		}
+	}
+
+}
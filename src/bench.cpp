@@ -0,0 +1,782 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Binary.h"
+#include "JSO2.h"
+#include "JSONParser.h"
+#include "LazyDocument.h"
+#include "MappedDocument.h"
+#include "MappedFile.h"
+#include "Ndjson.h"
+#include "Number.h"
+#include "Parallel.h"
+#include "Reader.h"
+#include "Sax.h"
+#include "Scan.h"
+
+std::atomic<size_t> allocated_bytes = 0;
+
+// 置き換えた new と delete が呼び出し側に展開されると, GCC は operator new の結果を
+// free に渡していると見て -Wmismatched-new-delete を出す. 展開させずに malloc と free の組に閉じる.
+[[gnu::noinline]] void *operator new(size_t size) {
+	allocated_bytes += size;
+	if(void *p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+[[gnu::noinline]] void *operator new(size_t size, std::align_val_t align) {
+	allocated_bytes += size;
+	size_t a = std::max(size_t(align), sizeof(void *));
+	if(void *p = std::aligned_alloc(a, (size + a - 1) / a * a)) return p;
+	throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void *p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void *p, size_t) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void *p, size_t, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+namespace {
+
+	std::string make_document(size_t records) {
+		std::string doc = "[\n";
+		for(size_t i = 0; i < records; ++i) {
+			doc += "  {\n";
+			doc += "    \"id\"    : " + std::to_string(i) + ",\n";
+			doc += "    \"x\"     : " + std::to_string(i * 0.001) + ",\n";
+			doc += "    \"v\"     : -" + std::to_string(i % 977) + ".25e-3,\n";
+			doc += "    \"label\" : \"record " + std::to_string(i) + "\",\n";
+			doc += "    \"valid\" : " + std::string(i % 3 ? "true" : "false") + "\n";
+			doc += i + 1 < records ? "  },\n" : "  }\n";
+		}
+		doc += "]\n";
+		return doc;
+	}
+
+	// 文字列の外側の空白を取り除く
+	std::string minify(const std::string &src) {
+		std::string dest;
+		bool				in_string = false;
+		for(size_t i = 0; i < src.size(); ++i) {
+			const char c = src[i];
+			if(in_string) {
+				dest.push_back(c);
+				if(c == '\\')
+					dest.push_back(src[++i]);
+				else if(c == '"')
+					in_string = false;
+			} else if(!JSO2::scan::is_white_space(c)) {
+				dest.push_back(c);
+				in_string = c == '"';
+			}
+		}
+		return dest;
+	}
+
+	// 最良の経過時間 [s] を返す. 失敗した場合は負の値.
+	template <class F>
+	double measure(F &&f) {
+		const int n_repeat = 3;
+		double		best		 = 1e300;
+		for(int i = 0; i < n_repeat; ++i) {
+			auto start = std::chrono::steady_clock::now();
+			if(!f()) return -1;
+			std::chrono::duration<double> elapsed =
+					std::chrono::steady_clock::now() - start;
+			best = std::min(best, elapsed.count());
+		}
+		return best;
+	}
+
+	template <class F>
+	void throughput(const std::string &name, size_t bytes, F &&f) {
+		const double t = measure(f);
+		if(t < 0)
+			std::cout << name << " : failed\n";
+		else
+			std::cout << name << " : " << t * 1e3 << " ms, "
+								<< bytes / t / (1 << 20) << " MiB/s\n";
+	}
+
+	void bench_load(const std::string &path) {
+		const size_t bytes = std::filesystem::file_size(path);
+		std::cout << "# load : " << path << " (" << bytes << " bytes)\n";
+
+		throughput("JSON::Value::parse(std::ifstream)", bytes, [&] {
+			std::ifstream src(path);
+			return bool(JSON::Value::parse(src));
+		});
+		throughput("JSON::Value::parse_file", bytes,
+							 [&] { return bool(JSON::Value::parse_file(path)); });
+		throughput("JSO2::load(std::ifstream)", bytes, [&] {
+			std::ifstream src(path);
+			JSO2::JSO2		root;
+			return root.load(src);
+		});
+		throughput("JSO2::load_file", bytes, [&] {
+			JSO2::JSO2 root;
+			return root.load_file(path);
+		});
+		throughput("JSO2::Document::load_file", bytes, [&] {
+			JSO2::Document doc;
+			return doc.load_file(path);
+		});
+	}
+
+	// "id" の値だけを集める
+	struct id_sum : JSO2::sax::handler {
+		double sum		= 0;
+		bool	 is_id	= false;
+		void	 on_key(std::string_view key) { is_id = key == "id"; }
+		void	 on_number(double x) {
+			if(is_id) sum += x;
+		}
+	};
+
+	void bench_sax(const std::string &path) {
+		const size_t bytes = std::filesystem::file_size(path);
+		std::cout << "# sax : sum of \"id\"\n";
+
+		throughput("JSO2::load_file + lookup", bytes, [&] {
+			JSO2::JSO2 root;
+			if(!root.load_file(path)) return false;
+			double sum = 0;
+			for(const auto &rec : root.as<JSO2::JSO2::Array>())
+				sum += rec["id"].as<JSO2::JSO2::Number>();
+			return sum > 0;
+		});
+		throughput("JSO2::sax::parse_file", bytes, [&] {
+			id_sum h;
+			return JSO2::sax::parse_file(path, h) && h.sum > 0;
+		});
+	}
+
+	// pipe から届く想定で chunk ごとに feed する
+	void bench_reader(const std::string &path) {
+		const size_t bytes = std::filesystem::file_size(path);
+		std::cout << "# reader : feed in chunks\n";
+
+		for(size_t chunk : {size_t(4) << 10, size_t(64) << 10}) {
+			const std::string size = std::to_string(chunk >> 10) + " KiB";
+			std::vector<char> buf(chunk);
+			size_t						peak = 0;
+			throughput("JSO2::Reader::next() tokens, " + size, bytes, [&] {
+				std::ifstream src(path, std::ios::binary);
+				JSO2::Reader	reader;
+				size_t				tokens = 0;
+				while(src.read(buf.data(), chunk) || src.gcount()) {
+					reader.feed(buf.data(), src.gcount());
+					while(reader.next() != JSO2::Reader::token::none) ++tokens;
+					peak = std::max(peak, reader.buffered());
+				}
+				reader.finish();
+				return tokens > 0 && reader.next() == JSO2::Reader::token::none;
+			});
+			throughput("JSO2::Reader::next(JSO2&), " + size, bytes, [&] {
+				std::ifstream src(path, std::ios::binary);
+				JSO2::Reader	reader;
+				JSO2::JSO2		value;
+				size_t				values = 0;
+				while(src.read(buf.data(), chunk) || src.gcount()) {
+					reader.feed(buf.data(), src.gcount());
+					while(reader.next(value)) ++values;
+				}
+				reader.finish();
+				return values == 1;
+			});
+			std::cout << "  -> " << peak << " bytes left over at most\n";
+		}
+	}
+
+	void bench_parallel(const std::string &path) {
+		const size_t bytes = std::filesystem::file_size(path);
+		std::cout << "# parallel : two-phase load\n";
+
+		JSO2::MappedFile file(path);
+		throughput("JSO2::scan::index (stage 1)", bytes, [&] {
+			return !JSO2::scan::index(file.data(), file.data() + file.size()).empty();
+		});
+		const size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+		for(size_t threads = 1;; threads = std::min(threads * 2, max_threads)) {
+			JSO2::parallel::options opt;
+			opt.threads = threads;
+			throughput("JSO2::parallel::load_file " + std::to_string(threads) +
+										 " threads",
+								 bytes, [&] {
+									 JSO2::JSO2 root;
+									 return JSO2::parallel::load_file(root, path, opt);
+								 });
+			if(threads == max_threads) break;
+		}
+	}
+
+	void bench_lazy(const std::string &path) {
+		const size_t bytes = std::filesystem::file_size(path);
+		std::cout << "# lazy : read root[1000][\"label\"]\n";
+
+		throughput("JSO2::load_file", bytes, [&] {
+			JSO2::JSO2 root;
+			return root.load_file(path) && !root[1000]["label"].view().empty();
+		});
+		throughput("JSO2::LazyDocument::load_file", bytes, [&] {
+			JSO2::LazyDocument doc;
+			return doc.load_file(path) && !doc[1000]["label"].view().empty();
+		});
+		throughput("JSO2::LazyDocument, every \"id\"", bytes, [&] {
+			JSO2::LazyDocument doc;
+			if(!doc.load_file(path)) return false;
+			double				 sum	= 0;
+			const auto		 root = doc.root();
+			for(size_t i = 0, n = root.size(); i < n; ++i)
+				sum += root[int(i)]["id"].number();
+			return sum > 0;
+		});
+	}
+
+	void bench_scan(size_t records) {
+		const std::string pretty = make_document(records);
+		const std::string compact = minify(pretty);
+		std::cout << "# scan : indented " << pretty.size() << " bytes ("
+							<< 100 - 100 * compact.size() / pretty.size()
+							<< "% white space), minified " << compact.size() << " bytes\n";
+
+		const std::pair<JSO2::scan::isa, const char *> isas[] = {
+				{JSO2::scan::isa::scalar, "scalar"},
+				{JSO2::scan::isa::sse2, "sse2"},
+				{JSO2::scan::isa::avx2, "avx2"}};
+		const JSO2::scan::isa detected = JSO2::scan::detect();
+		for(const auto &[isa, name] : isas) {
+			if(isa > detected) continue;
+			JSO2::scan::use(isa);
+			for(const auto *src : {&pretty, &compact}) {
+				throughput(std::string("JSO2::load ") + name +
+											 (src == &pretty ? " indented" : " minified"),
+									 src->size(), [&] {
+										 JSO2::JSO2 root;
+										 return root.load(std::string_view(*src));
+									 });
+			}
+		}
+		JSO2::scan::use(detected);
+	}
+
+	void bench_number(size_t count) {
+		std::mt19937_64										gen(1);
+		std::uniform_real_distribution<> dist(-1e3, 1e3);
+		std::string												src;
+		for(size_t i = 0; i < count; ++i) {
+			char buf[32];
+			snprintf(buf, sizeof(buf), i % 4 ? "%.17g," : "%.0f,", dist(gen));
+			src += buf;
+		}
+		std::cout << "# number : " << count << " numbers, " << src.size()
+							<< " bytes\n";
+
+		double sum = 0;
+		throughput("std::stod", src.size(), [&] {
+			for(const char *p = src.data(), *end = p + src.size(); p < end;) {
+				const char *q = std::find(p, end, ',');
+				sum += std::stod(std::string(p, q));
+				p = q + 1;
+			}
+			return true;
+		});
+		throughput("JSO2::number::parse", src.size(), [&] {
+			for(const char *p = src.data(), *end = p + src.size(); p < end;) {
+				double x;
+				p = JSO2::number::parse(p, end, x) + 1;
+				sum += x;
+			}
+			return true;
+		});
+		if(sum == 0) std::cout << "\n";
+
+		std::vector<double> values;
+		for(const char *p = src.data(), *end = p + src.size(); p < end;) {
+			double x;
+			p = JSO2::number::parse(p, end, x) + 1;
+			values.push_back(x);
+		}
+		size_t length = 0;
+		throughput("std::ostream << setprecision(17)", src.size(), [&] {
+			std::ostringstream dest;
+			dest.precision(17);
+			for(double x : values) dest << x << ',';
+			length = dest.str().size();
+			return true;
+		});
+		std::cout << "  -> " << length << " bytes\n";
+		throughput("JSO2::number::format", src.size(), [&] {
+			std::string dest;
+			char				buf[JSO2::number::max_length];
+			for(double x : values) {
+				dest.append(buf, JSO2::number::format(buf, x));
+				dest.push_back(',');
+			}
+			length = dest.size();
+			return true;
+		});
+		std::cout << "  -> " << length << " bytes\n";
+	}
+
+	void bench_dump(size_t records) {
+		JSO2::JSO2 root;
+		root.load(make_document(records));
+		const size_t bytes = root.dump().size();
+		std::cout << "# dump : " << records << " records, " << bytes
+							<< " bytes (pretty)\n";
+
+		throughput("operator<<(std::ostringstream)", bytes, [&] {
+			std::ostringstream dest;
+			dest << root;
+			return !dest.str().empty();
+		});
+		throughput("JSO2::dump", bytes, [&] { return !root.dump().empty(); });
+		throughput("JSO2::dump compact", bytes, [&] {
+			return !root.dump(JSO2::style::compact).empty();
+		});
+		std::vector<char> buf(bytes);
+		throughput("JSO2::serialize_to(char*, size_t)", bytes, [&] {
+			return root.serialize_to(buf.data(), buf.size()) == bytes;
+		});
+	}
+
+	void bench_ndjson(size_t records) {
+		std::string src;
+		for(size_t i = 0; i < records; ++i)
+			src += "{\"id\":" + std::to_string(i) + ",\"x\":" + std::to_string(i * 0.001) +
+						 ",\"label\":\"record " + std::to_string(i) + "\",\"valid\":" +
+						 (i % 3 ? "true" : "false") + "}\n";
+		std::cout << "# ndjson : " << records << " records, " << src.size()
+							<< " bytes\n";
+
+		throughput("JSO2::load per line", src.size(), [&] {
+			std::vector<JSO2::JSO2> values;
+			std::string_view				rest(src);
+			while(!rest.empty()) {
+				const size_t n = rest.find('\n');
+				values.emplace_back().load(rest.substr(0, n));
+				rest.remove_prefix(n + 1);
+			}
+			return values.size() == records;
+		});
+		const size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+		for(size_t threads = 1;; threads = std::min(threads * 2, max_threads)) {
+			JSO2::ndjson::options opt;
+			opt.threads = threads;
+			throughput("JSO2::ndjson::load " + std::to_string(threads) + " threads",
+								 src.size(), [&] {
+									 return JSO2::ndjson::load(src, opt).size() == records;
+								 });
+			if(threads == max_threads) break;
+		}
+	}
+
+	// 多数の小さな文書を JSON::Value::parse で同時に読み, 1 thread で読んだ結果と比べる
+	void bench_json_threads(size_t documents) {
+		std::vector<std::string> docs(documents);
+		for(size_t i = 0; i < documents; ++i) {
+			docs[i] = "[";
+			for(size_t j = 0; j < 20; ++j)
+				docs[i] += (j ? "," : "") + std::string("{\"id\":") + std::to_string(i * 20 + j) +
+									 ",\"label\":\"doc " + std::to_string(i) + "\\trecord " +
+									 std::to_string(j) + "\\n\",\"tags\":[\"a\",\"b\\\"" +
+									 std::to_string(j) + "\"]}";
+			docs[i] += "]";
+		}
+		auto print = [&](size_t i) {
+			std::ostringstream out;
+			out << *JSON::Value::parse(docs[i]);
+			return out.str();
+		};
+
+		std::vector<std::string> expected(documents);
+		for(size_t i = 0; i < documents; ++i) expected[i] = print(i);
+
+		const size_t threads = std::max(4u, std::thread::hardware_concurrency());
+		std::cout << "# JSON::Value::parse : " << documents << " documents on "
+							<< threads << " threads\n";
+		std::atomic<size_t> mismatches = 0;
+		const double				t					 = measure([&] {
+			 std::atomic<size_t>			next = 0;
+			 std::vector<std::thread> pool;
+			 for(size_t k = 0; k < threads; ++k)
+				 pool.emplace_back([&] {
+					 for(size_t i; (i = next++) < documents;)
+						 if(print(i) != expected[i]) ++mismatches;
+				 });
+			 for(auto &th : pool) th.join();
+			 return true;
+		 });
+		std::cout << "parse + print : " << t * 1e3 << " ms, " << mismatches
+							<< " mismatches\n";
+		if(mismatches) std::exit(1);
+	}
+
+	// 乱数の double の Array を 10 進, bit の 16 進, binary で読み戻す
+	void bench_hex(size_t count) {
+		std::mt19937													 gen(11);
+		std::uniform_real_distribution<double> dist(-1e6, 1e6);
+		JSO2::JSO2														 root;
+		for(size_t i = 0; i < count; ++i) root[int(i)] = dist(gen);
+
+		const std::string decimal = root.dump(JSO2::style::compact);
+		const std::string hex = root.dump(JSO2::style::compact | JSO2::style::hex_bits);
+		const std::string binary = JSO2::binary::encode(root);
+		std::cout << "# hex : " << count << " numbers, decimal " << decimal.size()
+							<< " bytes, hex " << hex.size() << " bytes, binary "
+							<< binary.size() << " bytes\n";
+
+		auto report = [&](const std::string &name, auto &&load) {
+			const double t = measure(load);
+			std::cout << name << " : " << t / count * 1e9 << " ns/number\n";
+		};
+		report("JSO2::load (decimal)", [&] {
+			JSO2::JSO2 dest;
+			return dest.load(decimal);
+		});
+		report("JSO2::load (hex_bits)", [&] {
+			JSO2::JSO2 dest;
+			return dest.load(hex);
+		});
+		report("JSO2::binary::decode", [&] {
+			JSO2::JSO2 dest;
+			return JSO2::binary::decode(dest, binary);
+		});
+	}
+
+	// 大きな数の Array を要素ごとの 10 進, hex_bits と base64 の block で書いて読む
+	void bench_block(size_t count) {
+		std::mt19937													 gen(13);
+		std::uniform_real_distribution<double> dist(-1e6, 1e6);
+		std::vector<double>										 xs(count);
+		for(auto &x : xs) x = dist(gen);
+		JSO2::JSO2 root;
+		root = std::span<const double>(xs);
+
+		const JSO2::style styles[] = {JSO2::style::compact,
+																	JSO2::style::compact | JSO2::style::hex_bits,
+																	JSO2::style::compact | JSO2::style::packed};
+		const char			 *names[] = {"decimal", "hex_bits", "packed"};
+		std::cout << "# block : " << count << " numbers\n";
+		for(int i = 0; i < 3; ++i) {
+			std::string text;
+			const double t_dump = measure([&] {
+				text = root.dump(styles[i]);
+				return true;
+			});
+			const double t_load = measure([&] {
+				JSO2::JSO2 dest;
+				return dest.load(text) && dest.numbers().size() == count;
+			});
+			std::cout << names[i] << " : " << text.size() << " bytes, dump "
+								<< t_dump / count * 1e9 << " ns/number, load " << t_load / count * 1e9
+								<< " ns/number\n";
+		}
+	}
+
+	// 起動時に表を開いて 1 つの値を引くまで
+	void bench_mapped(const std::string &path) {
+		JSO2::JSO2 root;
+		root.load_file(path);
+		const std::string image = path + ".map";
+		JSO2::MappedDocument::write_file(image, root);
+		const size_t last = ((const JSO2::JSO2::Array &)root).size() - 1;
+		std::cout << "# mapped : " << image << " ("
+							<< std::filesystem::file_size(image) << " bytes)\n";
+
+		double t = measure([&] {
+			JSO2::JSO2 dest;
+			return dest.load_file(path) && (double)dest[int(last)]["id"] == last;
+		});
+		std::cout << "JSO2::load_file + lookup : " << t * 1e3 << " ms\n";
+		t = measure([&] {
+			JSO2::MappedDocument doc;
+			return doc.open_file(image) && doc[int(last)]["id"].number() == last;
+		});
+		std::cout << "JSO2::MappedDocument::open_file + lookup : " << t * 1e3
+							<< " ms\n";
+		std::filesystem::remove(image);
+	}
+
+	// 数値の多い木を text と binary で書き出し / 読み戻す
+	void bench_binary(size_t records) {
+		std::mt19937													 gen(7);
+		std::uniform_real_distribution<double> dist(-1e3, 1e3);
+		JSO2::JSO2														 root;
+		for(size_t i = 0; i < records; ++i) {
+			JSO2::JSO2 &rec = root[int(i)];
+			rec["id"]				= double(i);
+			rec["label"]		= "state " + std::to_string(i);
+			for(int k = 0; k < 8; ++k) rec["q"][k] = dist(gen);
+		}
+
+		const std::string text	 = root.dump(JSO2::style::compact);
+		const std::string binary = JSO2::binary::encode(root);
+		std::cout << "# binary : " << records << " records, text " << text.size()
+							<< " bytes, binary " << binary.size() << " bytes\n";
+
+		throughput("JSO2::dump(compact)", text.size(),
+							 [&] { return !root.dump(JSO2::style::compact).empty(); });
+		throughput("JSO2::binary::encode", binary.size(),
+							 [&] { return !JSO2::binary::encode(root).empty(); });
+		throughput("JSO2::load", text.size(), [&] {
+			JSO2::JSO2 dest;
+			return dest.load(text);
+		});
+		throughput("JSO2::binary::decode", binary.size(), [&] {
+			JSO2::JSO2 dest;
+			return JSO2::binary::decode(dest, binary);
+		});
+	}
+
+	// src/test.cpp と同じ形の record を並べた木を組み立てる
+	void bench_build(size_t records) {
+		const size_t nodes = 1 + records * 7;
+		std::cout << "# build : " << records << " records, " << nodes
+							<< " nodes\n";
+
+		auto report = [&](const std::string &name, auto &&build) {
+			size_t bytes = 0;
+			double t		 = measure([&] {
+					size_t before = allocated_bytes;
+					auto	 root		= build();
+					bytes					= allocated_bytes - before;
+					return true;
+			});
+			std::cout << name << " : " << t * 1e3 << " ms, "
+								<< double(bytes) / nodes << " bytes/node\n";
+		};
+
+		report("JSO2::JSO2 (sizeof " + std::to_string(sizeof(JSO2::JSO2)) + ")",
+					 [&] {
+						 JSO2::JSO2 root;
+						 for(size_t i = 0; i < records; ++i) {
+							 JSO2::JSO2 &rec = root[int(i)];
+							 rec["alpha"]		 = 2.0;
+							 rec["beta"]		 = "PI!";
+							 rec["x"]				 = 1.2;
+							 rec["v"]				 = 0;
+							 rec["enable"]	 = true;
+							 rec["disable"]	 = false;
+						 }
+						 return root;
+					 });
+		report("JSON::Value (shared_ptr per node)", [&] {
+			auto root = std::make_shared<JSON::Array>();
+			for(size_t i = 0; i < records; ++i) {
+				auto rec = std::make_shared<JSON::Object>();
+				(*rec)["alpha"]		= std::make_shared<JSON::Number>(2.0);
+				(*rec)["beta"]		= std::make_shared<JSON::String>("PI!");
+				(*rec)["x"]				= std::make_shared<JSON::Number>(1.2);
+				(*rec)["v"]				= std::make_shared<JSON::Number>(0);
+				(*rec)["enable"]	= std::make_shared<JSON::True>();
+				(*rec)["disable"] = std::make_shared<JSON::False>();
+				root->push_back(rec);
+			}
+			return root;
+		});
+	}
+
+	// key 数ごとに, 同じ総 key 数 (約 10^6) を組み立てて全 key を引く時間
+	template <class Map>
+	void bench_object_backend(const std::string &name, size_t keys) {
+		const size_t repeat = std::max<size_t>(1, 1000000 / keys);
+		std::vector<std::string> names(keys);
+		for(size_t i = 0; i < keys; ++i) names[i] = "key_" + std::to_string(i * 7919);
+		std::vector<std::string> order = names;
+		std::shuffle(order.begin(), order.end(), std::mt19937(1));
+
+		std::vector<Map> maps(repeat);
+		const double build = measure([&] {
+			for(auto &m : maps) {
+				m = Map();
+				for(const auto &key : names) m[key] = 1.0;
+			}
+			return true;
+		});
+		size_t			 found	= 0;
+		const double lookup = measure([&] {
+			for(const auto &m : maps)
+				for(const auto &key : order) found += m.find(key) != m.end();
+			return found != 0;
+		});
+		const double total = double(repeat * keys);
+		std::cout << name << " : build " << build / total * 1e9 << " ns/key, lookup "
+							<< lookup / total * 1e9 << " ns/key\n";
+	}
+
+	// 長い文字列を多く含む文書を, 複製して読む場合と入力を指したまま読む場合
+	void bench_borrow(size_t records) {
+		std::string src = "[";
+		for(size_t i = 0; i < records; ++i) {
+			if(i) src += ",";
+			src += "{\"id\":" + std::to_string(i) +
+						 ",\"name\":\"a somewhat longer name of record " + std::to_string(i) +
+						 "\",\"path\":\"/var/lib/jso2/records/" + std::to_string(i % 97) +
+						 "/data.json\"}";
+		}
+		src += "]";
+		std::cout << "# borrow : " << records << " records, " << src.size()
+							<< " bytes\n";
+
+		auto report = [&](const std::string &name, auto &&load) {
+			size_t bytes = 0;
+			double t		 = measure([&] {
+				size_t		 before = allocated_bytes;
+				JSO2::JSO2 root;
+				if(!load(root)) return false;
+				bytes = allocated_bytes - before;
+				return true;
+			});
+			std::cout << name << " : " << t * 1e3 << " ms, " << bytes / records
+								<< " bytes/record\n";
+		};
+		report("JSO2::load", [&](JSO2::JSO2 &root) { return root.load(src); });
+		report("JSO2::load_borrowed",
+					 [&](JSO2::JSO2 &root) { return root.load_borrowed(src); });
+		report("JSO2::load_borrowed + materialize", [&](JSO2::JSO2 &root) {
+			if(!root.load_borrowed(src)) return false;
+			root.materialize();
+			return true;
+		});
+	}
+
+	// 同じ key を持つ record を文字列と Atom で引く
+	void bench_atom(size_t records) {
+		std::cout << "# atom : " << records << " records\n";
+		const char *names[] = {"alpha", "beta", "x", "v", "enable", "disable",
+													 "a_rather_long_key_name", "another_long_key_name"};
+		JSO2::JSO2						 root;
+		JSO2::JSO2::Array &arr = root = JSO2::JSO2::Array(records);
+		for(auto &rec : arr)
+			for(const char *name : names) rec[name] = 1.0;
+
+		double sum = 0;
+		double t	 = measure([&] {
+			for(auto &rec : arr)
+				for(const char *name : names) sum += (double)rec[name];
+			return true;
+		});
+		std::cout << "operator[](const char *) : " << t / (records * 8) * 1e9
+							<< " ns/lookup\n";
+
+		std::vector<JSO2::Atom> atoms;
+		for(const char *name : names) atoms.push_back(JSO2::intern(name));
+		t = measure([&] {
+			for(auto &rec : arr)
+				for(const auto &atom : atoms) sum += (double)rec[atom];
+			return true;
+		});
+		std::cout << "operator[](Atom) : " << t / (records * 8) * 1e9
+							<< " ns/lookup (" << sum << ")\n";
+
+		// load した木の key は Document の KeyPool の実体を指すので, その Atom と pointer で一致する
+		JSO2::Document doc;
+		if(!doc.load(root.dump(JSO2::style::compact))) return;
+		JSO2::JSO2::Array &loaded = doc.root();
+		t = measure([&] {
+			for(auto &rec : loaded)
+				for(const auto &atom : atoms) sum += (double)rec[atom];
+			return true;
+		});
+		std::cout << "Document::load + operator[](Atom) : " << t / (records * 8) * 1e9
+							<< " ns/lookup (" << sum << ")\n";
+	}
+
+	// 数だけの Array を詰めた表現と通常の Array で読み, 総和を取る
+	void bench_packed(size_t n) {
+		std::string src = "[";
+		for(size_t i = 0; i < n; ++i) {
+			if(i) src += ",";
+			src += std::to_string(i * 0.25);
+		}
+		src += "]";
+		std::cout << "# packed : " << n << " numbers, " << src.size() << " bytes\n";
+
+		JSO2::JSO2 packed, generic;
+		size_t		 bytes = 0;
+		double		 t		 = measure([&] {
+			size_t before = allocated_bytes;
+			packed				= JSO2::JSO2();
+			if(!packed.load(src)) return false;
+			bytes = allocated_bytes - before;
+			return true;
+		});
+		std::cout << "JSO2::load (Numbers) : " << t * 1e3 << " ms, " << bytes / n
+							<< " bytes/number\n";
+		t = measure([&] {
+			size_t before = allocated_bytes;
+			generic				= JSO2::JSO2();
+			if(!generic.load(src)) return false;
+			(void)(JSO2::JSO2::Array &)generic;
+			bytes = allocated_bytes - before;
+			return true;
+		});
+		std::cout << "JSO2::load + Array : " << t * 1e3 << " ms, " << bytes / n
+							<< " bytes/number\n";
+
+		double sum = 0;
+		t					 = measure([&] {
+			for(double x : packed.numbers()) sum += x;
+			return true;
+		});
+		std::cout << "sum over numbers() : " << t / n * 1e9 << " ns/number\n";
+		t = measure([&] {
+			for(const auto &val : generic.as<JSO2::JSO2::Array>()) sum += (double)val;
+			return true;
+		});
+		std::cout << "sum over Array : " << t / n * 1e9 << " ns/number (" << sum << ")\n";
+	}
+
+	void bench_object() {
+		for(size_t keys : {5, 100, 100000}) {
+			std::cout << "# object : " << keys << " keys\n";
+			bench_object_backend<std::pmr::map<std::string, JSO2::JSO2>>("std::pmr::map", keys);
+			bench_object_backend<JSO2::FlatMap<JSO2::JSO2>>("JSO2::FlatMap", keys);
+		}
+	}
+
+}
+
+int main(int argc, char **argv) {
+	std::string path;
+	if(argc > 1)
+		path = argv[1];
+	else {
+		path = (std::filesystem::temp_directory_path() / "jso2_bench.json").string();
+		std::ofstream(path) << make_document(200000);
+	}
+
+	bench_load(path);
+	bench_sax(path);
+	bench_reader(path);
+	bench_parallel(path);
+	bench_lazy(path);
+	bench_mapped(path);
+	bench_scan(200000);
+	bench_number(1000000);
+	bench_dump(200000);
+	bench_binary(100000);
+	bench_hex(1000000);
+	bench_block(1000000);
+	bench_ndjson(200000);
+	bench_json_threads(10000);
+	bench_build(200000);
+	bench_object();
+	bench_atom(200000);
+	bench_borrow(200000);
+	bench_packed(1000000);
+
+	return 0;
+}
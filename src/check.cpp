@@ -0,0 +1,1019 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Base64.h"
+#include "Binary.h"
+#include "FlatMap.h"
+#include "JSO2.h"
+#include "JSONParser.h"
+#include "LazyDocument.h"
+#include "MappedDocument.h"
+#include "Ndjson.h"
+#include "Number.h"
+#include "Parallel.h"
+#include "Reader.h"
+
+// ctest から走らせる動作の確認. 引数に名前を与えればその確認だけを行う.
+// 失敗した条件を出力し, 1 つでもあれば 1 で終わる.
+
+namespace {
+
+	size_t failures = 0;
+
+#define check(cond)                                                        \
+	do {                                                                     \
+		if(!(cond)) {                                                          \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #cond \
+								<< "\n";                                                     \
+			++failures;                                                          \
+		}                                                                      \
+	} while(0)
+
+	// 複数の thread で同時に parse と print を繰り返し, 1 thread で得た結果と比べる
+	void json_threads() {
+		const size_t						 documents = 2000;
+		std::vector<std::string> docs(documents);
+		for(size_t i = 0; i < documents; ++i) {
+			docs[i] = "[";
+			for(size_t j = 0; j < 20; ++j)
+				docs[i] += (j ? "," : "") + std::string("{\"id\":") + std::to_string(i * 20 + j) +
+									 ",\"x\":" + std::to_string(i * 0.001 + j) + ",\"label\":\"doc " +
+									 std::to_string(i) + "\\trecord " + std::to_string(j) +
+									 "\\n\",\"tags\":[\"a\",\"b\\\"" + std::to_string(j) + "\"]}";
+			docs[i] += "]";
+		}
+		auto print = [&](size_t i) {
+			std::ostringstream out;
+			if(auto value = JSON::Value::parse(docs[i])) out << *value;
+			return out.str();
+		};
+
+		std::vector<std::string> expected(documents);
+		for(size_t i = 0; i < documents; ++i) {
+			expected[i] = print(i);
+			check(!expected[i].empty());
+		}
+
+		const size_t				threads		 = std::max(4u, std::thread::hardware_concurrency());
+		std::atomic<size_t> next			 = 0;
+		std::atomic<size_t> mismatches = 0;
+		std::vector<std::thread> pool;
+		for(size_t k = 0; k < threads; ++k)
+			pool.emplace_back([&] {
+				// 各文書を 4 回ずつ, 別の thread と重なるように引き受ける
+				for(size_t i; (i = next++) < documents * 4;)
+					if(print(i % documents) != expected[i % documents]) ++mismatches;
+			});
+		for(auto &th : pool) th.join();
+		check(mismatches == 0);
+	}
+
+	// number::parse が std::strtod と同じ bit に丸めるか. 読めなければ false
+	bool parses_as(const std::string &src, double expected) {
+		double		  x;
+		const char *last = JSO2::number::parse(src.data(), src.data() + src.size(), x);
+		return last == src.data() + src.size() &&
+					 std::bit_cast<uint64_t>(x) == std::bit_cast<uint64_t>(expected);
+	}
+	bool rejects(const std::string &src) {
+		double x;
+		return JSO2::number::parse(src.data(), src.data() + src.size(), x) == nullptr;
+	}
+
+	// 10 進の丸め, 範囲外, 16 進の bit 表記
+	void number() {
+		// 丸めの境界 : 2^53 + 1 と 2^53 + 3 は偶数側へ
+		check(parses_as("9007199254740993", 9007199254740992.0));
+		check(parses_as("9007199254740995", 9007199254740996.0));
+		check(parses_as("0.1", std::bit_cast<double>(uint64_t(0x3FB999999999999A))));
+		check(parses_as("-0", -0.0));
+		check(parses_as("-0.0e10", -0.0));
+		// 最大の double, 最大の非正規数, 最小の非正規数
+		check(parses_as("1.7976931348623157e308", std::bit_cast<double>(uint64_t(0x7FEFFFFFFFFFFFFF))));
+		check(parses_as("2.2250738585072009e-308", std::bit_cast<double>(uint64_t(0x000FFFFFFFFFFFFF))));
+		check(parses_as("4.9406564584124654e-324", std::bit_cast<double>(uint64_t(1))));
+		// 最小の非正規数の半分をわずかに超えれば切り上げ, 下回れば 0
+		check(parses_as("2.4703282292062328e-324", std::bit_cast<double>(uint64_t(1))));
+		check(parses_as("2.4703282292062327e-324", 0.0));
+		check(parses_as("1e309", INFINITY));
+		check(parses_as("-1e309", -INFINITY));
+		check(parses_as("1e-400", 0.0));
+		check(parses_as("-1e-400", -0.0));
+		// 19 桁を超える mantissa
+		check(parses_as("123456789012345678901234567890", 123456789012345678901234567890.0));
+		check(parses_as("0.30000000000000000000000000000000000001", 0.3));
+		check(parses_as("1" + std::string(400, '0') + "e-400", 1.0));
+
+		for(const char *bad : {"", "-", "+1", ".5", "1e", "1e+", "-x", "0x3FF", "0x3FF000000000000",
+													 "0x3FF000000000000G"})
+			check(rejects(bad));
+		// 16 桁が続かない "0x" は 0 を読んで 'x' の前で止まる
+		{
+			const std::string src = "0x";
+			double						x;
+			check(JSO2::number::parse(src.data(), src.data() + src.size(), x) == src.data() + 1 &&
+						x == 0);
+		}
+
+		// 16 進 : 大文字と小文字, 符号と NaN の payload も bit のまま
+		check(parses_as("0x3FF0000000000000", 1.0));
+		check(parses_as("0x3ff0000000000000", 1.0));
+		check(parses_as("0x8000000000000000", -0.0));
+		check(parses_as("0x7FF8000000000001", std::bit_cast<double>(uint64_t(0x7FF8000000000001))));
+		check(parses_as("0xFFF0000000000000", -INFINITY));
+
+		// 乱数の bit : 10 進は std::strtod と, 16 進と最短表記は元の bit と一致する
+		std::mt19937_64 gen(8);
+		char						buf[JSO2::number::max_length];
+		for(size_t i = 0; i < 100000; ++i) {
+			const uint64_t bits = gen();
+			const double	 x		= std::bit_cast<double>(bits);
+			const std::string hex(buf, JSO2::number::format_hex(buf, x));
+			check(hex.size() == JSO2::number::hex_length && parses_as(hex, x));
+			if(!std::isfinite(x)) continue;
+			const std::string shortest(buf, JSO2::number::format(buf, x));
+			check(parses_as(shortest, x));
+			// 17 桁より長い表記は fast path に乗らない
+			std::snprintf(buf, sizeof(buf), "%.25e", x);
+			check(parses_as(buf, std::strtod(buf, nullptr)));
+		}
+		// 短い 10 進 : fast path と from_chars の境
+		std::uniform_int_distribution<int> exponent(-30, 30);
+		for(size_t i = 0; i < 100000; ++i) {
+			const std::string src =
+					std::to_string(gen() % 100000000000000000) + "e" + std::to_string(exponent(gen));
+			check(parses_as(src, std::strtod(src.c_str(), nullptr)));
+		}
+	}
+
+	// Reader の token を比べられる文字列に直す
+	std::string describe(const JSO2::Reader &reader, JSO2::Reader::token t) {
+		using token			= JSO2::Reader::token;
+		std::string out = std::to_string(int(t));
+		switch(t) {
+			case token::key:
+			case token::string:
+				out += " " + std::string(reader.text());
+				break;
+			case token::number:
+				out += " " + std::to_string(std::bit_cast<uint64_t>(reader.number()));
+				break;
+			case token::numbers:
+				for(double x : reader.numbers()) out += " " + std::to_string(x);
+				break;
+			case token::boolean:
+				out += reader.boolean() ? " true" : " false";
+				break;
+			default:
+				break;
+		}
+		return out;
+	}
+
+	// cuts の位置で切って feed し, 得た token を並べる
+	std::vector<std::string> read_tokens(const std::string &src, const std::vector<size_t> &cuts) {
+		JSO2::Reader						 reader;
+		std::vector<std::string> tokens;
+		auto										 drain = [&] {
+			for(JSO2::Reader::token t; (t = reader.next()) != JSO2::Reader::token::none;)
+				tokens.push_back(describe(reader, t));
+		};
+		size_t first = 0;
+		for(size_t cut : cuts) {
+			reader.feed(src.data() + first, cut - first);
+			drain();
+			first = cut;
+		}
+		reader.feed(src.data() + first, src.size() - first);
+		drain();
+		reader.finish();
+		drain();
+		return tokens;
+	}
+
+	// cuts の位置で切って feed し, next(JSO2&) で得た値を書き出して並べる
+	std::vector<std::string> read_values(const std::string &src, const std::vector<size_t> &cuts) {
+		JSO2::Reader						 reader;
+		std::vector<std::string> values;
+		JSO2::JSO2							 value;
+		auto										 drain = [&] {
+			while(reader.next(value)) values.push_back(value.dump(JSO2::style::compact));
+		};
+		size_t first = 0;
+		for(size_t cut : cuts) {
+			reader.feed(src.data() + first, cut - first);
+			drain();
+			first = cut;
+		}
+		reader.feed(src.data() + first, src.size() - first);
+		drain();
+		reader.finish();
+		drain();
+		return values;
+	}
+
+	// 全ての位置で 2 つに切っても, 1 byte ずつ送っても, 一度に送った場合と同じ token と値になる
+	void reader_chunks() {
+		const std::string src =
+				"{\"name\":\"caf\\u00e9 \\ud83d\\ude00 \\\"q\\\"\\n\", \"n\" : -12.5e-3,"
+				"\"big\":123456789012345678901,\"hex\":0x3FF0000000000000,"
+				"\"t\":true,\"f\":false,\"z\":null,\"xs\":[1, 2,[3,[]],{}],"
+				"\"b\":@f64(AAAAAAAA8D8AAAAAAAAAQA==),"
+				"\"long\":\"a string longer than the short string limit\"}\n"
+				"[true] \"tail\" 42";
+
+		const auto tokens = read_tokens(src, {});
+		const auto values = read_values(src, {});
+		check(tokens.size() == 37);
+		check(values.size() == 4);
+		if(values.size() == 4) {
+			JSO2::JSO2 expected;
+			check(expected.load(src.substr(0, src.find('\n'))));
+			check(values[0] == expected.dump(JSO2::style::compact));
+			check(values[1] == "[true]" && values[2] == "\"tail\"" && values[3] == "42");
+		}
+
+		for(size_t cut = 1; cut < src.size(); ++cut) {
+			check(read_tokens(src, {cut}) == tokens);
+			check(read_values(src, {cut}) == values);
+		}
+		std::vector<size_t> every(src.size() - 1);
+		for(size_t i = 0; i < every.size(); ++i) every[i] = i + 1;
+		check(read_tokens(src, every) == tokens);
+		check(read_values(src, every) == values);
+
+		// 長い文字列を細かく送っても, 届いた分を 1 度ずつしか調べない
+		const std::string long_string = "\"" + std::string(1 << 22, 'x') + "\"";
+		JSO2::Reader			reader;
+		size_t						found = 0;
+		for(size_t i = 0; i < long_string.size(); i += 16) {
+			reader.feed(std::string_view(long_string).substr(i, 16));
+			while(reader.next() == JSO2::Reader::token::string)
+				found += reader.text().size() == long_string.size() - 2;
+		}
+		check(found == 1 && reader.buffered() == 0);
+	}
+
+	// JSO2::load が std::invalid_argument を投げるか
+	bool load_throws(const std::string &src) {
+		try {
+			JSO2::JSO2 dest;
+			dest.load(src);
+		} catch(const std::invalid_argument &) {
+			return true;
+		}
+		return false;
+	}
+
+	std::string block(const char *kind, const void *data, size_t n) {
+		std::string text(JSO2::base64::encoded_length(n), '\0');
+		JSO2::base64::encode(text.data(), data, n);
+		return std::string("@") + kind + "(" + text + ")";
+	}
+
+	// base64 の block : 詰め物と長さの誤り, 非有限の値, SIMD の経路と 1 組ずつの経路の一致
+	void base64_block() {
+		JSO2::JSO2 dest;
+		check(dest.load("@f64(AAAAAAAA8D8=)") && dest.packed() && dest.numbers().size() == 1 &&
+					dest.numbers()[0] == 1);
+		check(dest.load("@f64()") && dest.packed() && dest.numbers().empty());
+		check(dest.load("@i32(AQAAAP////8=)") && dest.numbers().size() == 2 &&
+					dest.numbers()[0] == 1 && dest.numbers()[1] == -1);
+
+		// 詰め物の誤り : 4 の倍数でない, 途中の '=', '=' が 3 つ, 閉じていない
+		for(const char *bad : {"@f64(AAAAAAAA8D8)", "@i32(AQAAAA==AgAAAA==)", "@i32(AA=AAAAA)",
+													 "@i32(A===AAAA)", "@i32(AQAAAA==", "@f64(AAAAAAAA8D8=]",
+													 "@f16(AAAA)", "@f64"})
+			check(load_throws(bad));
+		// 長さが要素の幅の倍数でない
+		check(load_throws("@f32(AAAAAAAA)"));	 // 6 byte
+		check(load_throws("@i32(AAA=)"));			 // 2 byte
+		check(load_throws("@f64(AAAAAA==)"));		 // 4 byte
+		check(!load_throws("@f32(AAAAAA==)"));	 // 4 byte
+
+		// 非有限の値と -0 は bit のまま読み, style::packed で書いても bit のまま戻る
+		const double values[] = {INFINITY, -INFINITY, std::bit_cast<double>(uint64_t(0x7FF8000000000123)),
+														 -0.0, 5e-324};
+		check(dest.load(block("f64", values, sizeof(values))) && dest.numbers().size() == 5);
+		if(dest.numbers().size() == 5) {
+			check(std::memcmp(dest.numbers().data(), values, sizeof(values)) == 0);
+			JSO2::JSO2 again;
+			check(again.load(dest.dump(JSO2::style::packed)) && again.numbers().size() == 5 &&
+						std::memcmp(again.numbers().data(), values, sizeof(values)) == 0);
+		}
+		const float floats[] = {INFINITY, -INFINITY, NAN, -0.0f, 1.5f};
+		check(dest.load(block("f32", floats, sizeof(floats))) && dest.numbers().size() == 5);
+		if(dest.numbers().size() == 5) {
+			check(dest.numbers()[0] == INFINITY && dest.numbers()[1] == -INFINITY);
+			check(std::isnan(dest.numbers()[2]) && std::signbit(dest.numbers()[3]));
+			check(dest.numbers()[4] == 1.5);
+		}
+
+		// 長い block は SIMD で 16 文字ずつ復号する. 全ての位置の 1 文字の誤りを見つける
+		std::mt19937_64			 gen(25);
+		std::vector<double> xs(64);
+		for(auto &x : xs) x = std::bit_cast<double>(gen());
+		const std::string src = block("f64", xs.data(), xs.size() * sizeof(double));
+		check(dest.load(src) && dest.numbers().size() == xs.size() &&
+					std::memcmp(dest.numbers().data(), xs.data(), xs.size() * sizeof(double)) == 0);
+		for(size_t i = 5; i + 2 < src.size(); ++i)
+			for(char c : {'*', '=', '\x80'}) {
+				if(c == '=' && i + 3 >= src.size()) continue;
+				std::string bad = src;
+				bad[i]					= c;
+				check(load_throws(bad));
+			}
+		// 1 byte ずつ長さを変え, 詰め物の 3 通りを全て通す
+		std::vector<unsigned char> bytes(4 * 40);
+		for(auto &b : bytes) b = (unsigned char)gen();
+		for(size_t n = 0; n <= 40; ++n) {
+			check(dest.load(block("i32", bytes.data(), 4 * n)) && dest.numbers().size() == n);
+			for(size_t i = 0; i < n && i < dest.numbers().size(); ++i) {
+				int32_t v;
+				std::memcpy(&v, bytes.data() + 4 * i, 4);
+				check(dest.numbers()[i] == v);
+			}
+		}
+		std::vector<unsigned char> decoded(bytes.size());
+		for(size_t n = 0; n <= 64; ++n) {
+			const std::string text = block("f64", bytes.data(), n).substr(5);
+			const char			 *first = text.data(), *last = text.data() + text.size() - 1;
+			check(JSO2::base64::decoded_length(first, last) == n);
+			check(JSO2::base64::decode(first, last, decoded.data()) == decoded.data() + n &&
+						std::memcmp(decoded.data(), bytes.data(), n) == 0);
+		}
+	}
+
+	// JSON::hex_numbers で書いた数は JSON::Value::parse で bit のまま読み戻せる
+	void json_hex() {
+		std::mt19937_64 gen(23);
+		auto						 array = std::make_shared<JSON::Array>();
+		for(size_t i = 0; i < 1000; ++i)
+			array->push_back(std::make_shared<JSON::Number>(std::bit_cast<double>(gen())));
+		std::ostringstream out;
+		out << JSON::hex_numbers << *array;
+		const auto back = JSON::Value::parse(out.str());
+		check(back && back->type_id() == JSON::type::Array);
+		if(!back || back->type_id() != JSON::type::Array) return;
+		const auto &values = static_cast<const JSON::Array &>(*back);
+		check(values.size() == array->size());
+		for(size_t i = 0; i < values.size() && i < array->size(); ++i)
+			check(std::bit_cast<uint64_t>(double(static_cast<const JSON::Number &>(*values[i]))) ==
+						std::bit_cast<uint64_t>(double(static_cast<const JSON::Number &>(*(*array)[i]))));
+
+		std::ostringstream decimal;
+		decimal << JSON::hex_numbers << JSON::decimal_numbers << JSON::Number(0.5);
+		check(decimal.str() == "0.5");
+	}
+
+	// 深い入れ子も再帰せずに読み, 複製し, 書き出し, 解放する. max_depth を超えれば std::length_error
+	void deep_nesting() {
+		const size_t depth = 100000;
+		std::string		 arrays = std::string(depth, '[') + "1" + std::string(depth, ']');
+		std::string		 objects;
+		for(size_t i = 0; i < depth; ++i) objects += "{\"k\":";
+		objects += "null" + std::string(depth, '}');
+
+		for(const std::string *src : {&arrays, &objects}) {
+			JSO2::JSO2 doc;
+			check(doc.load(*src, depth));
+			JSO2::JSO2 copy = doc;
+			doc							= nullptr;
+			std::string out;
+			copy.serialize_to(out, JSO2::style::compact);
+			check(out == *src);
+
+			bool thrown = false;
+			try {
+				doc.load(*src, depth - 1);
+			} catch(const std::length_error &) { thrown = true; }
+			check(thrown);
+		}
+
+		// operator<< は serialize_to と同じ形に書く. 出力は深さの 2 乗で伸びるので浅めにする
+		const size_t shallow = 2000;
+		JSO2::JSO2	 doc;
+		check(doc.load(std::string(shallow, '[') + "[1,2],{\"a\":[],\"bc\":{}}" +
+									 std::string(shallow, ']')));
+		std::ostringstream out;
+		out << doc;
+		std::string expected;
+		doc.serialize_to(expected);
+		check(out.str() == expected);
+	}
+
+	// load_borrowed はエスケープの無い長い文字列だけ入力を指し, materialize で切り離す
+	void borrowed_strings() {
+		std::string src = R"({"long":"a string longer than fourteen","short":"tiny",)"
+											R"("escaped":"a string \"longer\" than fourteen","xs":["another long string"]})";
+		auto inside = [&](const JSO2::JSO2 &s) {
+			const std::less<const char *> before;
+			return !before(s.view().data(), src.data()) &&
+						 before(s.view().data(), src.data() + src.size());
+		};
+
+		JSO2::JSO2 doc;
+		check(doc.load_borrowed(src));
+		check(doc["long"].borrowed() && inside(doc["long"]));
+		check(!doc["short"].borrowed() && !doc["escaped"].borrowed());
+		check(doc["escaped"].view() == "a string \"longer\" than fourteen");
+		check(doc["xs"][0].borrowed());
+		// 複製も同じ入力を指す
+		const JSO2::JSO2 copy = doc;
+		check(copy["long"].borrowed() && copy["long"].view().data() == doc["long"].view().data());
+
+		JSO2::JSO2 plain;
+		check(plain.load(src) && !plain["long"].borrowed());
+
+		doc.materialize();
+		check(!doc["long"].borrowed() && !inside(doc["long"]) && !doc["xs"][0].borrowed());
+		JSO2::Document arena_doc;
+		check(arena_doc.load_borrowed(src) && arena_doc["long"].borrowed());
+		arena_doc.materialize();
+		check(!arena_doc["long"].borrowed());
+
+		// 入力を書き換えても materialize した木は変わらない
+		std::fill(src.begin(), src.end(), '#');
+		check(doc["long"].view() == "a string longer than fourteen");
+		check(doc["xs"][0].view() == "another long string");
+		check(arena_doc["long"].view() == "a string longer than fourteen");
+		check(copy["long"].view() != "a string longer than fourteen");
+	}
+
+	// JSON::Value は JSO2::load と同じく文字列を復号し, 同じ入力を拒む
+	void json_strings() {
+		for(const char *src : {R"("plain")", R"("tab\tquote\"slash\/")", R"("caf\u00e9")",
+													 R"("\ud83d\ude00 smile")", R"("\u0000nul")", R"({"k\u0041":"v"})"}) {
+			JSO2::JSO2 expected;
+			check(expected.load(std::string_view(src)));
+			const auto value = JSON::Value::parse(src);
+			check(value != nullptr);
+			if(!value) continue;
+			if(value->type_id() == JSON::type::String)
+				check(static_cast<const std::string &>(static_cast<const JSON::String &>(*value)) ==
+							expected.view());
+			else {
+				const auto &obj = static_cast<const JSON::Object &>(*value);
+				check(obj.size() == 1 && obj.begin()->first == "kA");
+			}
+		}
+		for(const char *bad : {R"("\ud83d\u0041")", R"("\u12")", R"("\x")", R"("open)"}) {
+			check(JSON::Value::parse(bad) == nullptr);
+			check(load_throws(bad));
+		}
+	}
+
+	// const の std::string の参照 : heap の文字列はそのまま, 短い文字列は heap に移して返す.
+	// Document の文字列は view() で読み, 木を残すなら detach する
+	void string_access() {
+		const std::string src	 = R"({"short":"abc","long":"a string longer than fourteen"})";
+		const std::string other = R"({"long":"another string, also long enough"})";
+
+		JSO2::JSO2 tree;
+		check(tree.load(src));
+		const JSO2::JSO2	&c	 = tree;
+		const std::string &str = c["long"];
+		check(str == "a string longer than fourteen" && &str == &(const std::string &)c["long"]);
+		const std::string &abc = c["short"];
+		check(abc == "abc" && &abc == &c["short"].as<std::string>());
+
+		JSO2::Document doc;
+		check(doc.load(src));
+		const JSO2::Document &cd		 = doc;
+		bool									thrown = false;
+		try {
+			(void)(const std::string &)cd["long"];
+		} catch(const std::logic_error &) { thrown = true; }
+		check(thrown && cd["long"].view() == "a string longer than fourteen");
+
+		// detach した木は Document の再 load や入力の破棄の後も読める
+		JSO2::JSO2 kept = doc.detach();
+		check(doc.root().get_type() == JSO2::type::Value);
+		check(doc.load(other) && doc["long"].view() == "another string, also long enough");
+		check((const std::string &)std::as_const(kept)["long"] == "a string longer than fourteen");
+		{
+			std::string input = other;
+			check(doc.load_borrowed(input) && doc["long"].borrowed());
+			kept = doc.detach();
+			std::fill(input.begin(), input.end(), '#');
+		}
+		check(!kept["long"].borrowed() && kept["long"].view() == "another string, also long enough");
+	}
+
+	// 詰めた Array の添字 : const でも数を読め, 数を読み書きする間は展開しない
+	void packed_access() {
+		JSO2::JSO2 doc;
+		check(doc.load(R"({"xs":[1.5,2,3],"m":[[1,2],[3,4]]})"));
+		const JSO2::JSO2 &c = doc;
+		const double			x = c["xs"][0];
+		check(x == 1.5 && c["xs"][1].get_type() == JSO2::type::Number);
+		check(c["m"][1][0].as<JSO2::JSO2::Number>() == 3 && c["m"][1].packed());
+		check(&(const double &)c["xs"][2] == &c["xs"].numbers()[2]);
+		bool thrown = false;
+		try {
+			(void)(const JSO2::JSO2 &)c["xs"][0];
+		} catch(const std::logic_error &) { thrown = true; }
+		check(thrown);
+		std::ostringstream out;
+		out << c["xs"][1];
+		check(out.str() == "2" && c["xs"][1].dump(JSO2::style::compact) == "2");
+
+		// 数の読み書きでは詰めたまま
+		check((double)doc["xs"][1] == 2 && doc["xs"].packed());
+		doc["xs"][1] = 5;
+		(double &)doc["xs"][2] += 1;
+		doc["xs"][0] = doc["xs"][1];
+		check(doc["xs"].packed() && doc["xs"].numbers()[0] == 5 && doc["xs"].numbers()[1] == 5 &&
+					doc["xs"].numbers()[2] == 4);
+		// 数以外の代入や JSO2 & としての取り出しで展開する
+		doc["xs"][1] = "five";
+		check(!doc["xs"].packed() && doc["xs"][1].view() == "five" && (double)doc["xs"][2] == 4);
+		JSO2::JSO2 &m = doc["m"][0];
+		check(!doc["m"].packed() && m.packed());
+		// key の順は backend による
+		check(doc["xs"].dump(JSO2::style::compact) == R"([5,"five",4])" &&
+					doc["m"].dump(JSO2::style::compact) == "[[1,2],[3,4]]");
+	}
+
+	// 木の形. 詰めた Array は '#' と要素数で表す
+	std::string shape(const JSO2::JSO2 &node) {
+		std::string ret;
+		switch(node.get_type()) {
+			case JSO2::type::Object:
+				ret = "{";
+				for(const auto &[key, val] : (const JSO2::JSO2::Object &)node) ret += std::string(key) + ":" + shape(val) + ",";
+				return ret + "}";
+			case JSO2::type::Array:
+				if(node.packed()) return "#" + std::to_string(node.numbers().size());
+				ret = "[";
+				for(const auto &val : (const JSO2::JSO2::Array &)node) ret += shape(val) + ",";
+				return ret + "]";
+			default:
+				return node.dump(JSO2::style::compact);
+		}
+	}
+
+	// どの経路で組んだ木も JSO2::load と同じく数だけの Array を詰める
+	void packed_paths() {
+		for(const std::string src : {R"({"e":[],"m":[[1,2],[3,"a"]],"xs":[1,2,3]})", "[1,2,3]",
+																 R"([[1.5],{"k":[0,1]},[]])"}) {
+			JSO2::JSO2 expected;
+			check(expected.load(src));
+			const std::string form = shape(expected);
+
+			JSO2::JSO2 parallel;
+			check(JSO2::parallel::load(parallel, src, {.threads = 2}) && shape(parallel) == form);
+			JSO2::JSO2 decoded;
+			check(JSO2::binary::decode(decoded, JSO2::binary::encode(expected)) &&
+						shape(decoded) == form);
+			const auto values = read_values(src, {src.size() / 2});
+			JSO2::JSO2 read;
+			check(values.size() == 1 && read.load(values[0]) && shape(read) == form);
+			JSO2::Reader reader;
+			reader.feed(src);
+			check(reader.next(read) && shape(read) == form);
+
+			std::string image;
+			JSO2::MappedDocument::write(image, expected);
+			JSO2::MappedDocument mapped;
+			check(mapped.open(image) && shape(mapped.root().value()) == form);
+		}
+
+		// 詰めた Array は tag と要素数の後に 8 byte ずつ並べる
+		JSO2::JSO2 xs;
+		check(xs.load("[1,2,3]"));
+		check(JSO2::binary::encode(xs).size() == JSO2::binary::magic.size() + 1 + 1 + 1 + 3 * 8);
+		// 版 1 は数を 1 つずつ tag を付けて書く
+		std::string v1 = std::string(JSO2::binary::magic) + '\x01' + '\x05' + '\x02';
+		for(double x : {1.0, 2.0}) {
+			v1 += '\x03';
+			v1.append((const char *)&x, 8);
+		}
+		JSO2::JSO2 old;
+		check(JSO2::binary::decode(old, v1) && shape(old) == "#2");
+
+		// operator[] で組んだ Array も数だけなら詰める
+		JSO2::JSO2 built;
+		built["xs"][2] = 3;
+		built["xs"][0] = 1;
+		check(shape(built) == "{xs:#3,}" && built["xs"].numbers()[1] == 0);
+		built["ys"][0]["k"] = true;
+		check(shape(built) == "{xs:#3,ys:[{k:true,},],}");
+	}
+
+	// 最初の key の文字列の位置
+	const char *key_data(const JSO2::JSO2 &obj) {
+		return std::string_view(((const JSO2::JSO2::Object &)obj).begin()->first).data();
+	}
+
+	// load した木は同じ key の文字列を 1 つだけ持ち, Document から切り離しても共有する
+	void shared_keys() {
+		if(JSO2::is_ordered<JSO2::JSO2::Object>) return;	// std::pmr::map は key を 1 つずつ持つ
+		const std::string src = R"([{"name":1},{"name":2},{"name":{"name":3}}])";
+		auto shared = [](const JSO2::JSO2 &root) {
+			const char *name = key_data(root[0]);
+			return key_data(root[1]) == name && key_data(root[2]) == name &&
+						 key_data(root[2]["name"]) == name;
+		};
+
+		JSO2::JSO2 loaded;
+		check(loaded.load(src) && shared(loaded));
+		JSO2::Reader reader;
+		reader.feed(src);
+		JSO2::JSO2 read;
+		check(reader.next(read) && shared(read));
+		JSO2::JSO2 decoded;
+		check(JSO2::binary::decode(decoded, JSO2::binary::encode(loaded)) && shared(decoded));
+
+		JSO2::Document doc;
+		check(doc.load(src) && shared(doc.root()));
+		const JSO2::JSO2 detached = doc.detach();
+		check(shared(detached) && (JSO2::JSO2::Number)detached[2]["name"]["name"] == 3);
+		// 複製した木も key を共有し, 元の木より長く生きる
+		JSO2::JSO2 copy = loaded;
+		loaded					= JSO2::JSO2();
+		check(shared(copy) && (JSO2::JSO2::Number)copy[1]["name"] == 2);
+
+		// intern した Atom で引いた要素は key をその Atom の実体に替える
+		const JSO2::Atom name = JSO2::intern("name");
+		check((JSO2::JSO2::Number)copy[0][name] == 1 && key_data(copy[0]) == name.view().data());
+		check((JSO2::JSO2::Number)((const JSO2::JSO2 &)copy[1])[name] == 2);
+	}
+
+	// Document は木を arena 上に組む. heap の値との代入, detach, 再 load の後も値が正しい
+	void document_arena() {
+		check(sizeof(JSO2::JSO2) == 16);
+		const std::string long_text(40, 'x');
+		const std::string src =
+				R"({"name":"a string longer than the local buffer","xs":[1,2,3],"o":{"t":true,"n":null}})";
+		JSO2::JSO2 heap;
+		check(heap.load(src));
+		JSO2::Document doc;
+		check(doc.load(src) && doc.dump() == heap.dump());
+
+		// heap の値を arena の木に写す. 元の木を捨てても残る
+		doc["added"] = heap["o"];
+		doc["name"]	 = long_text;
+		heap				 = JSO2::JSO2();
+		check(doc["added"]["t"].get_type() == JSO2::type::True &&
+					doc["added"]["n"].get_type() == JSO2::type::Null && doc["name"].view() == long_text);
+
+		// detach した木は arena から切り離され, Document の再 load の後も残る
+		const JSO2::JSO2 detached = doc.detach();
+		check(doc.root().get_type() == JSO2::type::Value);
+		check(doc.load("[\"" + std::string(100, 'y') + "\"]") && doc[0].view() == std::string(100, 'y'));
+		check(detached["name"].view() == long_text &&
+					detached["added"]["t"].get_type() == JSO2::type::True && (double)detached["xs"][2] == 3);
+
+		// 失敗した load は例外を投げ, 次の load は空の arena から始める
+		bool thrown = false;
+		try {
+			doc.load(R"({"a":[1,2)");
+		} catch(const std::invalid_argument &) {
+			thrown = true;
+		}
+		check(thrown && doc.load(src) && doc["xs"].numbers().size() == 3);
+	}
+
+	// serialize_to(buf, size) は入る所までを書き, 切り詰めても全体の長さを返す
+	void serialize_buffer() {
+		JSO2::JSO2 src;
+		check(src.load(R"({"a":[1,2.5,"s\n"],"b":{"c":null,"d":"\u00e9"}})"));
+		for(JSO2::style s : {JSO2::style::compact, JSO2::style::pretty, JSO2::style::sorted}) {
+			const std::string whole = src.dump(s);
+			std::string				appended = "head";
+			src.serialize_to(appended, s);
+			check(appended == "head" + whole);
+			check(src.serialize_to(nullptr, 0, s) == whole.size());
+			for(size_t size = 0; size <= whole.size() + 1; ++size) {
+				std::string	 buf(size + 1, '#');
+				const size_t n = std::min(size, whole.size());
+				check(src.serialize_to(buf.data(), size, s) == whole.size());
+				check(buf.compare(0, n, whole, 0, n) == 0 && buf[n] == '#');
+			}
+		}
+	}
+
+	// 行の区切り, 入力の順と読み終えた順, 途中の行の文法違反
+	void ndjson() {
+		const auto records =
+				JSO2::ndjson::split("{\"a\":\"x\\\"#\"}\n\n  # comment\n[1,2] # tail\n\"b\nc\"");
+		check(records.size() == 3 && records[0] == "{\"a\":\"x\\\"#\"}" && records[1] == "[1,2] # tail" &&
+					records[2] == "\"b\nc\"");
+
+		constexpr size_t n = 1000;
+		std::string			 src;
+		for(size_t i = 0; i < n; ++i) src += "{\"i\":" + std::to_string(i) + "}\n";
+		const JSO2::ndjson::options opt = {.threads = 4};
+		const auto									values = JSO2::ndjson::load(src, opt);
+		bool												ordered = values.size() == n;
+		for(size_t i = 0; ordered && i < n; ++i) ordered = (double)values[i]["i"] == double(i);
+		check(ordered);
+
+		size_t next = 0;
+		JSO2::ndjson::for_each(src, [&](size_t i, JSO2::JSO2 &v) {
+			check(i == next++ && (double)v["i"] == double(i));
+		}, opt);
+		check(next == n);
+		std::vector<char> seen(n, 0);
+		JSO2::ndjson::for_each(src, [&](size_t i, JSO2::JSO2 &v) {
+			check(!seen[i] && (double)v["i"] == double(i));
+			seen[i] = 1;
+		}, {.threads = 4, .emit = JSO2::ndjson::order::completion});
+		check(std::count(seen.begin(), seen.end(), 1) == n);
+
+		// 1 行に 2 つの値, 閉じていない値は文法違反. どの thread で見つけても投げ直す
+		for(const std::string bad : {"1 2\n", "{\"a\":\n"}) {
+			bool thrown = false;
+			try {
+				JSO2::ndjson::load(src + bad + src, opt);
+			} catch(const std::invalid_argument &) {
+				thrown = true;
+			}
+			check(thrown);
+		}
+	}
+
+	// 最上位の要素を分けて読んでも JSO2::load と同じ木になり, 例外も同じ
+	void parallel_load() {
+		std::string arr = "[", obj = "{";
+		for(size_t i = 0; i < 2000; ++i) {
+			const std::string n = std::to_string(i);
+			if(i) arr += ',', obj += ',';
+			arr += R"({"i":)" + n + R"(,"s":"\u00e9)" + n + R"(","xs":[)" + n + "]}";
+			obj += "\"k" + std::to_string(i % 1500) + "\":" + n;	// 重複した key
+		}
+		const std::string body = arr;	// 閉じていない Array
+		arr += "] # tail";
+		obj += "}";
+		for(const std::string &src : {arr, obj, std::string("\"scalar\""), std::string("[]"),
+																	std::string(" { } ")}) {
+			JSO2::JSO2 expected, dest;
+			check(expected.load(src));
+			for(size_t threads : {1, 3, 8})
+				check(JSO2::parallel::load(dest, src, {.threads = threads}) &&
+							dest.dump(JSO2::style::compact) == expected.dump(JSO2::style::compact));
+		}
+		JSO2::JSO2 dest;
+		check(!JSO2::parallel::load(dest, "  "));
+
+		// 後ろの組の文法違反と入れ子の深さ
+		const std::string deep = "[" + std::string(100, '[') + std::string(100, ']') + "]";
+		bool							syntax = false, depth = false;
+		try {
+			JSO2::parallel::load(dest, body + ",{]]", {.threads = 4});
+		} catch(const std::invalid_argument &) { syntax = true; }
+		try {
+			JSO2::parallel::load(dest, body + "," + deep + "]", {.threads = 4, .max_depth = 50});
+		} catch(const std::length_error &) { depth = true; }
+		check(syntax && depth);
+	}
+
+	// 辿った所だけを読む. 辿らない部分の文法違反は value() で読むまで見つからない
+	void lazy_document() {
+		const std::string src =
+				R"({"a":{"b":[1,"two",true,@f64(AAAAAAAA8D8=)]},"bad":[1,,2],"esc":"x\u00e9","plain":"text"})";
+		JSO2::LazyDocument doc;
+		check(doc.load(src) && doc.root().get_type() == JSO2::type::Object);
+		const auto b = doc["a"]["b"];
+		check(b.size() == 4 && b[0].number() == 1 && b[1].view() == "two" && b[2].boolean());
+		check(b[3].size() == 1 && b[3].value().numbers()[0] == 1);
+		check(doc["esc"].view() == "x\u00e9" && doc.root().contains("bad") && !doc.root().contains("c"));
+		// エスケープの無い文字列は入力を指す
+		check(doc["plain"].view().data() == src.data() + src.find("text"));
+		check(doc["a"].value().dump(JSO2::style::compact) == R"({"b":[1,"two",true,[1]]})");
+
+		auto throws = [](auto f, auto e) {
+			try {
+				f();
+			} catch(const decltype(e) &) { return true; }
+			return false;
+		};
+		check(throws([&] { doc["bad"].value(); }, std::invalid_argument("")));
+		check(throws([&] { doc["c"]; }, std::out_of_range("")));
+		check(throws([&] { b[4]; }, std::out_of_range("")));
+		check(throws([&] { doc.load(R"({"a":[1,2})"); }, std::invalid_argument("")));
+		check(!doc.load(" \n"));
+	}
+
+	// linear_limit を越えると表で引き, erase で下回れば順に比べる. どちらでも全ての key を引ける
+	void flatmap_index() {
+		using map	= JSO2::FlatMap<int>;
+		auto key = [](int i) { return "key" + std::to_string(i); };
+		// [first, last) の key だけを持つ
+		auto all = [&](const map &m, int first, int last) {
+			bool ok = m.size() == size_t(last - first);
+			for(int i = first; i < last; ++i) ok = ok && m.find(key(i)) != m.end() && m.at(key(i)) == i;
+			return ok && !m.contains(key(last)) && !m.contains(key(first - 1));
+		};
+		const int n = 100;
+		map				m;
+		for(int i = 0; i < n; ++i) {
+			m[key(i)] = i;
+			check(all(m, 0, i + 1));
+		}
+		// 既にある key は足さない
+		m[key(5)] = 5;
+		check(m.size() == n);
+		for(int i = 0; i < n; ++i) {
+			check(m.erase(key(i)) == 1 && m.erase(key(i)) == 0);
+			check(all(m, i + 1, n));
+		}
+
+		// Atom でも文字列と同じ要素を引き, 非 const で引けば key をその実体に替える
+		const JSO2::Atom atom = JSO2::intern("key3");
+		for(int size : {int(map::linear_limit), 2 * n}) {
+			map a;
+			for(int i = 0; i < size; ++i) a[key(i)] = i;
+			check(a.find(atom) != a.end() && a.find(atom)->second == 3);
+			check(a[atom] == 3 && a.find(atom)->first.id() == atom.id() && a.size() == size_t(size));
+		}
+		map r;
+		r.reserve(2 * n);
+		for(int i = 0; i < n; ++i) r[key(i)] = i;
+		check(all(r, 0, n));
+	}
+
+	// FlatMap の要素を反復の順に繋ぐ
+	std::string order_of(const JSO2::FlatMap<int> &m) {
+		std::string ret;
+		for(const auto &[key, val] : m) ret += std::string(key) + "=" + std::to_string(val) + ",";
+		return ret;
+	}
+
+	// Object は挿入の順を保つ. erase は後ろを詰め, merge は足りない key を後ろに足す
+	void flatmap_order() {
+		JSO2::FlatMap<int> m;
+		for(int i = 0; i < 20; ++i) m[std::to_string((i * 7) % 20)] = i;
+		check(m.begin()->first == "0" && (m.begin() + 1)->first == "7" && (m.end() - 1)->first == "13");
+		m.erase("7");
+		m["7"] = 99;
+		check(order_of(m).starts_with("0=0,14=2,1=3,") && order_of(m).ends_with("13=19,7=99,"));
+
+		JSO2::FlatMap<int> a, b;
+		a["x"] = 1, a["y"] = 2;
+		b["y"] = 3, b["z"] = 4, b["w"] = 5;
+		a.merge(b);
+		check(order_of(a) == "x=1,y=2,z=4,w=5," && order_of(b) == "y=3,");
+
+		if(JSO2::is_ordered<JSO2::JSO2::Object>) return;	// std::pmr::map は key の順
+		// 重複した key は最初の位置に後の値が入る. style::sorted は書く時だけ並べ替える
+		JSO2::JSO2 doc;
+		check(doc.load(R"({"z":1,"a":2,"m":3,"a":4})"));
+		check(doc.dump(JSO2::style::compact) == R"({"z":1,"a":4,"m":3})");
+		check(doc.dump(JSO2::style::compact | JSO2::style::sorted) == R"({"a":4,"m":3,"z":1})");
+		doc["b"] = 5;
+		check(doc.dump(JSO2::style::compact) == R"({"z":1,"a":4,"m":3,"b":5})");
+	}
+
+	// encode して decode した木は bit まで同じで, 切れた入力や余りは例外になる
+	void binary_roundtrip() {
+		JSO2::JSO2 src;
+		check(src.load(R"({"s":"x\u0000y","long":")" + std::string(300, 'l') +
+									 R"(","e":{},"a":[],"m":[1,"a",null,true,false,[[2]]]})"));
+		const double bits[] = {-0.0, 5e-324, INFINITY, std::bit_cast<double>(uint64_t(0x7FF8000000000123))};
+		src["xs"] = std::span<const double>(bits);
+		src["n"]	= std::bit_cast<double>(uint64_t(0xFFF0000000000001));
+
+		const std::string image = JSO2::binary::encode(src);
+		check(image.starts_with(JSO2::binary::magic) && image[4] == JSO2::binary::version);
+		JSO2::JSO2 back;
+		check(JSO2::binary::decode(back, image) && JSO2::binary::encode(back) == image);
+		check(back["s"].view() == std::string_view("x\0y", 3) && back["xs"].packed() &&
+					std::bit_cast<uint64_t>(back["xs"].numbers()[3]) == 0x7FF8000000000123 &&
+					std::signbit(back["xs"].numbers()[0]));
+		std::string appended = "head";
+		JSO2::binary::encode_to(appended, src);
+		check(appended == "head" + image);
+
+		auto invalid = [](std::string_view bytes) {
+			JSO2::JSO2 dest;
+			try {
+				JSO2::binary::decode(dest, bytes);
+			} catch(const std::invalid_argument &) { return true; }
+			return false;
+		};
+		JSO2::JSO2 dest;
+		check(!JSO2::binary::decode(dest, ""));
+		bool truncated = true;
+		for(size_t n = 1; n < image.size(); ++n) truncated = truncated && invalid(image.substr(0, n));
+		check(truncated && invalid(image + '\0') && invalid("JSON" + image.substr(4)));
+
+		bool depth = false, untyped = false;
+		JSO2::JSO2 deep;
+		check(deep.load(std::string(20, '[') + std::string(20, ']')));
+		try {
+			JSO2::binary::decode(dest, JSO2::binary::encode(deep), 10);
+		} catch(const std::length_error &) { depth = true; }
+		try {
+			JSO2::binary::encode(JSO2::JSO2());
+		} catch(const std::logic_error &) { untyped = true; }
+		check(depth && untyped);
+	}
+
+	// MappedDocument は辿った所の offset と長さを入力の範囲で確かめる
+	void mapped_ranges() {
+		JSO2::JSO2 src;
+		check(src.load(R"({"k":"v","b":[1,true,null,"str"],"a":{"x":2.5},"long":")" +
+									 std::string(100, 'l') + "\"}"));
+		std::string image;
+		JSO2::MappedDocument::write(image, src);
+		JSO2::MappedDocument doc;
+		check(doc.open(image) && doc.root().size() == 4);
+		// key はバイト順に並び, 二分探索で引く
+		check(doc.root().key(0) == "a" && doc["a"]["x"].number() == 2.5 && doc["b"][3].view() == "str");
+		check(doc.root().value().dump(JSO2::style::compact | JSO2::style::sorted) ==
+					src.dump(JSO2::style::compact | JSO2::style::sorted));
+
+		// 全体を辿る. 例外の種類を返し, 範囲の外は読まない
+		auto walk = [](std::string_view bytes) -> std::string {
+			JSO2::MappedDocument doc;
+			try {
+				if(!doc.open(bytes)) return "empty";
+				doc.root().value();
+				return "ok";
+			} catch(const std::invalid_argument &) { return "invalid"; }
+		};
+		check(walk(image) == "ok" && walk("") == "empty" && walk("JSO2MAP") == "invalid");
+		bool truncated = true;
+		for(size_t n = 1; n < image.size(); ++n) truncated = truncated && walk(image.substr(0, n)) == "invalid";
+		check(truncated);
+
+		// root の slot (magic の直後) : payload 8 byte, size 4 byte, type 1 byte
+		auto corrupt = [&](size_t at, const std::string &bytes) {
+			std::string bad = image;
+			bad.replace(at, bytes.size(), bytes);
+			return walk(bad);
+		};
+		const size_t root = JSO2::MappedDocument::magic.size();
+		uint64_t		 block;
+		std::memcpy(&block, image.data() + root, 8);
+		check(corrupt(root, std::string(8, '\xFF')) == "invalid");			// 入力の外の block
+		check(corrupt(root + 12, std::string(1, '\0')) == "invalid");		// type::Value
+		check(corrupt(root + 12, std::string(1, '\x7F')) == "invalid");	// 不明な type
+		check(corrupt(block, std::string(8, '\x7F')) == "invalid");			// 入りきらない要素数
+
+		bool out_of_range = false;
+		try {
+			doc["b"][4];
+		} catch(const std::out_of_range &) { out_of_range = true; }
+		check(out_of_range && !doc.root().contains("c"));
+	}
+
+	struct test {
+		const char *name;
+		void (*run)();
+	};
+	const test tests[] = {
+			{"json_threads", json_threads},
+			{"json_hex", json_hex},
+			{"json_strings", json_strings},
+			{"number", number},
+			{"reader_chunks", reader_chunks},
+			{"base64_block", base64_block},
+			{"deep_nesting", deep_nesting},
+			{"borrowed_strings", borrowed_strings},
+			{"string_access", string_access},
+			{"packed_access", packed_access},
+			{"packed_paths", packed_paths},
+			{"shared_keys", shared_keys},
+			{"document_arena", document_arena},
+			{"serialize_buffer", serialize_buffer},
+			{"ndjson", ndjson},
+			{"parallel_load", parallel_load},
+			{"lazy_document", lazy_document},
+			{"flatmap_index", flatmap_index},
+			{"flatmap_order", flatmap_order},
+			{"binary_roundtrip", binary_roundtrip},
+			{"mapped_ranges", mapped_ranges},
+	};
+
+}
+
+int main(int argc, char **argv) {
+	bool ran = false;
+	for(const auto &t : tests)
+		if(argc < 2 || std::strcmp(argv[1], t.name) == 0) {
+			const size_t before = failures;
+			t.run();
+			ran = true;
+			std::cout << t.name << (failures == before ? " : ok\n" : " : FAILED\n");
+		}
+	if(!ran) std::cerr << "no such test : " << argv[1] << "\n";
+	return failures || !ran ? 1 : 0;
+}
@@ -1,5 +1,4 @@
 #include <cmath>
-#include <iomanip>
 #include <iostream>
 
 #include "JSO2.h"
@@ -19,7 +18,7 @@ int main() {
 	root["disable"]				= false;
 	root["blank-element"] = nullptr;
 
-	std::cout << std::setprecision(15) << root << "\n";
+	std::cout << root << "\n";
 
 	root.load(std::cin);
 